@@ -0,0 +1,103 @@
+/* Copyright (c) 2019-2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* Cost of cron_next() for a set of cron expressions: the run time and
+ * the ccronexpr counters, averaged over a range of start times.
+ *
+ * usage: cronexpr [<iterations>] [<expression> ...]
+ */
+#include <err.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ccronexpr.h"
+
+static const char *const expressions[] = {
+    "* * * * * *",     /* every second */
+    "0 */5 * * * *",   /* every 5 minutes */
+    "0 0 0 * * *",     /* daily */
+    "0 0 0 * * 1-5",   /* weekdays */
+    "0 0 0 31 * *",    /* 31st of the month */
+    "0 0 0 29 2 *",    /* leap day */
+    "0 0 0 13 * 5",    /* friday the 13th */
+    "0 0 0 29 2 1",    /* leap day on a monday: beyond the search limit */
+    NULL,
+};
+
+static void bench(const char *expression, int n);
+
+int main(int argc, char *argv[]) {
+  int n = 1000;
+  int i;
+
+  if (argc > 1)
+    n = atoi(argv[1]);
+
+  if (n <= 0)
+    errx(2, "usage: cronexpr [<iterations>] [<expression> ...]");
+
+  (void)printf("%-16s %9s %7s %6s %8s %8s %8s %6s\n", "EXPRESSION",
+               "MEAN(ns)", "CALLS", "DEPTH", "DAYS", "MKTIME", "BITS",
+               "ERRORS");
+
+  if (argc > 2) {
+    for (i = 2; i < argc; i++)
+      bench(argv[i], n);
+  } else {
+    for (i = 0; expressions[i] != NULL; i++)
+      bench(expressions[i], n);
+  }
+
+  return 0;
+}
+
+static void bench(const char *expression, int n) {
+  cron_expr expr = {0};
+  cron_counters counters = {0};
+  const char *errbuf = NULL;
+  struct timespec t0;
+  struct timespec t1;
+  time_t now;
+  int errors = 0;
+  int i;
+
+  cron_parse_expr(expression, &expr, &errbuf);
+  if (errbuf != NULL)
+    errx(2, "%s: %s", expression, errbuf);
+
+  now = time(NULL);
+
+  cron_set_counters(&counters);
+  (void)clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  /* start times are spread over about a year */
+  for (i = 0; i < n; i++) {
+    if (cron_next(&expr, now + (time_t)i * 7919) == -1)
+      errors++;
+  }
+
+  (void)clock_gettime(CLOCK_MONOTONIC, &t1);
+  cron_set_counters(NULL);
+
+  (void)printf("%-16s %9.0f %7.1f %6lu %8.1f %8.1f %8.1f %6d\n", expression,
+               ((double)(t1.tv_sec - t0.tv_sec) * 1e9 +
+                (double)(t1.tv_nsec - t0.tv_nsec)) /
+                   n,
+               (double)counters.do_next_calls / n, counters.do_next_depth,
+               (double)counters.find_next_day_iterations / n,
+               (double)counters.cron_mktime_calls / n,
+               (double)counters.next_set_bit_scans / n, errors);
+}
@@ -0,0 +1,190 @@
+/* Copyright (c) 2019-2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* Memory used by idle runcron processes. Starts a number of jobs which
+ * are not due to run, waits until each is sleeping and reports the
+ * resident (RSS), proportional (PSS) and private dirty memory of the
+ * sleeping supervisors.
+ *
+ * usage: idle [-n <instances>] <runcron> [<runcron> ...]
+ */
+#include <err.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+enum { RSS, PSS, PRIVATE_DIRTY, ANONYMOUS, FIELDS };
+
+static const char *const field_name[] = {"Rss:", "Pss:", "Private_Dirty:",
+                                         "Anonymous:"};
+
+static pid_t start(const char *runcron, int n);
+static int smaps(pid_t pid, long *kb);
+
+int main(int argc, char *argv[]) {
+  pid_t *pid;
+  int n = 100;
+  int ch;
+  int i;
+  int j;
+  size_t k;
+
+  while ((ch = getopt(argc, argv, "n:")) != -1) {
+    switch (ch) {
+    case 'n':
+      n = atoi(optarg);
+      break;
+    default:
+      n = 0;
+      break;
+    }
+  }
+
+  argc -= optind;
+  argv += optind;
+
+  if (n <= 0 || argc < 1)
+    errx(2, "usage: idle [-n <instances>] <runcron> [<runcron> ...]");
+
+  pid = calloc((size_t)n, sizeof(pid_t));
+  if (pid == NULL)
+    err(111, "calloc");
+
+  (void)printf("%-28s %9s %9s %9s %9s %9s\n", "RUNCRON", "INSTANCES",
+               "RSS(kB)", "PSS(kB)", "DIRTY(kB)", "ANON(kB)");
+
+  for (i = 0; i < argc; i++) {
+    long total[FIELDS] = {0};
+
+    for (j = 0; j < n; j++) {
+      pid[j] = start(argv[i], j);
+      if (pid[j] < 0)
+        err(111, "%s", argv[i]);
+    }
+
+    for (j = 0; j < n; j++) {
+      long kb[FIELDS] = {0};
+
+      if (smaps(pid[j], kb) < 0)
+        err(111, "smaps: %d", pid[j]);
+
+      for (k = 0; k < FIELDS; k++)
+        total[k] += kb[k];
+    }
+
+    for (j = 0; j < n; j++) {
+      char file[64];
+
+      (void)kill(pid[j], SIGTERM);
+      (void)waitpid(pid[j], NULL, 0);
+
+      (void)snprintf(file, sizeof(file), ".runcron.idle.%d", j);
+      (void)unlink(file);
+    }
+
+    (void)printf("%-28s %9d %9ld %9ld %9ld %9ld\n", argv[i], n, total[RSS],
+                 total[PSS], total[PRIVATE_DIRTY], total[ANONYMOUS]);
+    (void)printf("%-28s %9s %9ld %9ld %9ld %9ld\n", argv[i], "(each)",
+                 total[RSS] / n, total[PSS] / n, total[PRIVATE_DIRTY] / n,
+                 total[ANONYMOUS] / n);
+  }
+
+  return 0;
+}
+
+/* Start a job and wait until it is sleeping. */
+static pid_t start(const char *runcron, int n) {
+  char file[64];
+  char buf[1024];
+  size_t len = 0;
+  ssize_t r;
+  int fd[2];
+  pid_t pid;
+
+  (void)snprintf(file, sizeof(file), ".runcron.idle.%d", n);
+
+  if (pipe(fd) < 0)
+    return -1;
+
+  pid = fork();
+  switch (pid) {
+  case -1:
+    return -1;
+  case 0:
+    if (dup2(fd[1], 3) < 0)
+      _exit(127);
+    (void)execl(runcron, runcron, "-f", file, "--events-fd", "3",
+                "0 0 1 1 *", "/bin/true", (char *)NULL);
+    _exit(127);
+  default:
+    break;
+  }
+
+  (void)close(fd[1]);
+
+  for (;;) {
+    r = read(fd[0], buf + len, sizeof(buf) - 1 - len);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      break;
+
+    len += (size_t)r;
+    buf[len] = '\0';
+
+    if (strstr(buf, "\"event\":\"sleeping\"") != NULL) {
+      (void)close(fd[0]);
+      return pid;
+    }
+
+    if (len == sizeof(buf) - 1)
+      len = 0;
+  }
+
+  (void)close(fd[0]);
+  (void)kill(pid, SIGKILL);
+  (void)waitpid(pid, NULL, 0);
+  errno = ECHILD;
+  return -1;
+}
+
+static int smaps(pid_t pid, long *kb) {
+  char path[64];
+  char line[256];
+  FILE *fp;
+  size_t k;
+
+  (void)snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", pid);
+
+  fp = fopen(path, "r");
+  if (fp == NULL)
+    return -1;
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    for (k = 0; k < FIELDS; k++) {
+      size_t len = strlen(field_name[k]);
+
+      if (strncmp(line, field_name[k], len) == 0)
+        kb[k] = strtol(line + len, NULL, 10);
+    }
+  }
+
+  return fclose(fp);
+}
@@ -0,0 +1,141 @@
+/* Copyright (c) 2019-2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* Latency of the state file updates made for each run of a job in each
+ * --state-sync mode:
+ *
+ *   open: create the state file
+ *   start: write the running status and start time
+ *   end: write the exit status and record
+ *
+ * usage: state_sync [<iterations>] [<directory>]
+ */
+#include <err.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "exit_status.h"
+
+static const char *const modes[] = {"none", "data", "full"};
+
+static long long elapsed(struct timespec *t0);
+static int compare(const void *a, const void *b);
+static void report(const char *mode, const char *op, long long *t, int n);
+
+int main(int argc, char *argv[]) {
+  char file[PATH_MAX];
+  const char *dir = ".";
+  long long *t_open;
+  long long *t_start;
+  long long *t_end;
+  int n = 1000;
+  int mode;
+  int i;
+
+  if (argc > 1)
+    n = atoi(argv[1]);
+  if (argc > 2)
+    dir = argv[2];
+
+  if (n <= 0)
+    errx(2, "usage: state_sync [<iterations>] [<directory>]");
+
+  t_open = calloc((size_t)n, sizeof(long long));
+  t_start = calloc((size_t)n, sizeof(long long));
+  t_end = calloc((size_t)n, sizeof(long long));
+  if (t_open == NULL || t_start == NULL || t_end == NULL)
+    err(111, "calloc");
+
+  (void)snprintf(file, sizeof(file), "%s/.state_sync.%d", dir, (int)getpid());
+
+  (void)printf("%-5s %-6s %10s %10s %10s %10s\n", "MODE", "OP", "MEAN(us)",
+               "P50(us)", "P99(us)", "MAX(us)");
+
+  for (mode = EXIT_STATUS_SYNC_NONE; mode <= EXIT_STATUS_SYNC_FULL; mode++) {
+    for (i = 0; i < n; i++) {
+      exit_status_t es;
+      struct timespec t0;
+      int status = 0;
+
+      (void)unlink(file);
+
+      (void)clock_gettime(CLOCK_MONOTONIC, &t0);
+      if (open_exit_status(file, &es, mode, &status) < 0)
+        err(111, "open_exit_status: %s", file);
+      t_open[i] = elapsed(&t0);
+
+      (void)clock_gettime(CLOCK_MONOTONIC, &t0);
+      if (write_exit_status(&es, 128 + SIGKILL) < 0)
+        err(111, "write_exit_status");
+      exit_status_start(&es, time(NULL));
+      if (sync_exit_status(&es, EXIT_STATUS_SYNC_FULL) < 0)
+        err(111, "sync_exit_status");
+      t_start[i] = elapsed(&t0);
+
+      (void)clock_gettime(CLOCK_MONOTONIC, &t0);
+      exit_status_end(&es, time(NULL), 0, 0, NULL);
+      if (write_exit_status(&es, 0) < 0)
+        err(111, "write_exit_status");
+      if (sync_exit_status(&es, EXIT_STATUS_SYNC_DATA) < 0)
+        err(111, "sync_exit_status");
+      t_end[i] = elapsed(&t0);
+
+      (void)close(es.fd);
+    }
+
+    report(modes[mode], "open", t_open, n);
+    report(modes[mode], "start", t_start, n);
+    report(modes[mode], "end", t_end, n);
+  }
+
+  (void)unlink(file);
+
+  return 0;
+}
+
+/* nanoseconds since t0 */
+static long long elapsed(struct timespec *t0) {
+  struct timespec t1;
+
+  (void)clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  return (long long)(t1.tv_sec - t0->tv_sec) * 1000000000LL +
+         (t1.tv_nsec - t0->tv_nsec);
+}
+
+static int compare(const void *a, const void *b) {
+  long long x = *(const long long *)a;
+  long long y = *(const long long *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static void report(const char *mode, const char *op, long long *t, int n) {
+  long long sum = 0;
+  int i;
+
+  qsort(t, (size_t)n, sizeof(long long), compare);
+
+  for (i = 0; i < n; i++)
+    sum += t[i];
+
+  (void)printf("%-5s %-6s %10.1f %10.1f %10.1f %10.1f\n", mode, op,
+               (double)sum / n / 1000, (double)t[n / 2] / 1000,
+               (double)t[(n * 99) / 100] / 1000, (double)t[n - 1] / 1000);
+}
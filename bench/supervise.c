@@ -0,0 +1,356 @@
+/* Copyright (c) 2019-2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* End to end latency of the runcron supervisor. Each iteration runs a job
+ * which is due immediately (a failed run with a retry interval of 0) and
+ * uses the --events-fd timestamps to measure:
+ *
+ *   start: process start to acquiring the lock and parsing the schedule
+ *   sleep: lock to sleeping
+ *   exec: waking up to the task calling exec(3)
+ *   exit: task exit to runcron exit
+ *
+ * One additional run is traced to count the system calls made by the
+ * supervisor and by its children (the cron expression parser and the
+ * task).
+ *
+ * usage: supervise [-n <iterations>] [-t <task>] <runcron> [<runcron> ...]
+ */
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STATE_FILE ".runcron.bench.lock"
+
+enum { START, SLEEP, EXEC, EXIT, TOTAL, PHASES };
+
+static const char *const phase_name[] = {"start", "sleep", "exec", "exit",
+                                         "total"};
+
+static const char *task = "/bin/true";
+
+static int run(const char *runcron, const char *opt, double *phase);
+static int run_traced(const char *runcron, const char *opt,
+                      unsigned long *self, unsigned long *children);
+static void exec_runcron(const char *runcron, const char *opt, int fd);
+static int reset_state(void);
+static double event_time(const char *buf, const char *event);
+static double now(void);
+static int compare(const void *a, const void *b);
+static void report(const char *runcron, const char *opt, double *t[], int n,
+                   unsigned long self, unsigned long children);
+
+int main(int argc, char *argv[]) {
+  static const char *const opts[] = {NULL, "--disable-process-restrictions"};
+  double *t[PHASES];
+  int n = 1000;
+  int ch;
+  int i;
+  int j;
+  size_t k;
+
+  while ((ch = getopt(argc, argv, "n:t:")) != -1) {
+    switch (ch) {
+    case 'n':
+      n = atoi(optarg);
+      break;
+    case 't':
+      task = optarg;
+      break;
+    default:
+      n = 0;
+      break;
+    }
+  }
+
+  argc -= optind;
+  argv += optind;
+
+  if (n <= 0 || argc < 1)
+    errx(2, "usage: supervise [-n <iterations>] [-t <task>] <runcron> "
+            "[<runcron> ...]");
+
+  for (k = 0; k < PHASES; k++) {
+    t[k] = calloc((size_t)n, sizeof(double));
+    if (t[k] == NULL)
+      err(111, "calloc");
+  }
+
+  (void)printf("%-36s %-6s %9s %9s %9s %9s\n", "RUNCRON", "PHASE", "P50(us)",
+               "P90(us)", "P99(us)", "MAX(us)");
+
+  for (i = 0; i < argc; i++) {
+    for (k = 0; k < sizeof(opts) / sizeof(opts[0]); k++) {
+      unsigned long self = 0;
+      unsigned long children = 0;
+
+      for (j = 0; j < n; j++) {
+        double phase[PHASES];
+        size_t p;
+
+        if (run(argv[i], opts[k], phase) < 0)
+          errx(111, "%s: run failed", argv[i]);
+
+        for (p = 0; p < PHASES; p++)
+          t[p][j] = phase[p];
+      }
+
+      if (run_traced(argv[i], opts[k], &self, &children) < 0)
+        warn("%s: ptrace", argv[i]);
+
+      report(argv[i], opts[k], t, n, self, children);
+    }
+  }
+
+  (void)unlink(STATE_FILE);
+
+  return 0;
+}
+
+/* Run a job and calculate the duration of each phase in microseconds. */
+static int run(const char *runcron, const char *opt, double *phase) {
+  char buf[4096];
+  size_t len = 0;
+  double t0;
+  double t1;
+  double parsed;
+  double sleeping;
+  double woke;
+  double exec;
+  double exited;
+  int fd[2];
+  int status;
+  ssize_t n;
+  pid_t pid;
+
+  if (reset_state() < 0 || pipe(fd) < 0)
+    return -1;
+
+  t0 = now();
+
+  pid = fork();
+  switch (pid) {
+  case -1:
+    return -1;
+  case 0:
+    exec_runcron(runcron, opt, fd[1]);
+    _exit(127);
+  default:
+    break;
+  }
+
+  (void)close(fd[1]);
+
+  while (len < sizeof(buf) - 1 &&
+         (n = read(fd[0], buf + len, sizeof(buf) - 1 - len)) != 0) {
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    len += (size_t)n;
+  }
+  buf[len] = '\0';
+
+  (void)close(fd[0]);
+
+  if (waitpid(pid, &status, 0) < 0)
+    return -1;
+
+  t1 = now();
+
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    return -1;
+
+  parsed = event_time(buf, "parsed");
+  sleeping = event_time(buf, "sleeping");
+  woke = event_time(buf, "woke");
+  exec = event_time(buf, "exec");
+  exited = event_time(buf, "exited");
+
+  if (parsed < 0 || sleeping < 0 || woke < 0 || exec < 0 || exited < 0)
+    return -1;
+
+  phase[START] = (parsed - t0) * 1e6;
+  phase[SLEEP] = (sleeping - parsed) * 1e6;
+  phase[EXEC] = (exec - woke) * 1e6;
+  phase[EXIT] = (t1 - exited) * 1e6;
+  phase[TOTAL] = (t1 - t0) * 1e6;
+
+  return 0;
+}
+
+/* Count the system calls made by runcron and by its children. */
+static int run_traced(const char *runcron, const char *opt,
+                      unsigned long *self, unsigned long *children) {
+  struct __ptrace_syscall_info info;
+  int status;
+  pid_t pid;
+  pid_t p;
+
+  if (reset_state() < 0)
+    return -1;
+
+  pid = fork();
+  switch (pid) {
+  case -1:
+    return -1;
+  case 0:
+    if (ptrace(PTRACE_TRACEME, 0, NULL, NULL) < 0)
+      _exit(127);
+    (void)raise(SIGSTOP);
+    exec_runcron(runcron, opt, -1);
+    _exit(127);
+  default:
+    break;
+  }
+
+  if (waitpid(pid, &status, 0) < 0)
+    return -1;
+
+  if (ptrace(PTRACE_SETOPTIONS, pid, NULL,
+             PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACEFORK |
+                 PTRACE_O_TRACEVFORK | PTRACE_O_TRACECLONE |
+                 PTRACE_O_EXITKILL) < 0 ||
+      ptrace(PTRACE_SYSCALL, pid, NULL, NULL) < 0) {
+    (void)kill(pid, SIGKILL);
+    (void)waitpid(pid, &status, 0);
+    return -1;
+  }
+
+  while ((p = waitpid(-1, &status, __WALL)) > 0) {
+    int sig = 0;
+
+    if (WIFEXITED(status) || WIFSIGNALED(status))
+      continue;
+
+    if (WIFSTOPPED(status)) {
+      if (WSTOPSIG(status) == (SIGTRAP | 0x80)) {
+        if (ptrace(PTRACE_GET_SYSCALL_INFO, p, (void *)sizeof(info), &info) >
+                0 &&
+            info.op == PTRACE_SYSCALL_INFO_ENTRY)
+          (*(p == pid ? self : children))++;
+      } else if (WSTOPSIG(status) != SIGTRAP && WSTOPSIG(status) != SIGSTOP) {
+        sig = WSTOPSIG(status);
+      }
+    }
+
+    (void)ptrace(PTRACE_SYSCALL, p, NULL, (void *)(long)sig);
+  }
+
+  return 0;
+}
+
+static void exec_runcron(const char *runcron, const char *opt, int fd) {
+  const char *argv[12];
+  int n = 0;
+
+  argv[n++] = runcron;
+  argv[n++] = "-R";
+  argv[n++] = "0";
+  argv[n++] = "-f";
+  argv[n++] = STATE_FILE;
+
+  if (opt != NULL)
+    argv[n++] = opt;
+
+  if (fd > -1) {
+    if (dup2(fd, 3) < 0)
+      _exit(127);
+    argv[n++] = "--events-fd";
+    argv[n++] = "3";
+  }
+
+  argv[n++] = "* * * * *";
+  argv[n++] = task;
+  argv[n++] = NULL;
+
+  (void)execv(runcron, (char *const *)argv);
+}
+
+/* A failed run is retried immediately. */
+static int reset_state(void) {
+  int fd;
+
+  (void)unlink(STATE_FILE);
+
+  fd = open(STATE_FILE, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0)
+    return -1;
+
+  if (write(fd, "\001", 1) != 1) {
+    (void)close(fd);
+    return -1;
+  }
+
+  return close(fd);
+}
+
+/* CLOCK_MONOTONIC time of an event in seconds */
+static double event_time(const char *buf, const char *event) {
+  char key[64];
+  const char *p;
+
+  (void)snprintf(key, sizeof(key), "{\"event\":\"%s\",\"monotonic\":", event);
+
+  p = strstr(buf, key);
+  if (p == NULL)
+    return -1;
+
+  return strtod(p + strlen(key), NULL);
+}
+
+static double now(void) {
+  struct timespec ts;
+
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static int compare(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+static void report(const char *runcron, const char *opt, double *t[], int n,
+                   unsigned long self, unsigned long children) {
+  char name[256];
+  size_t p;
+
+  (void)snprintf(name, sizeof(name), "%s%s", runcron,
+                 opt == NULL ? "" : " (unrestricted)");
+
+  for (p = 0; p < PHASES; p++) {
+    qsort(t[p], (size_t)n, sizeof(double), compare);
+    (void)printf("%-36s %-6s %9.1f %9.1f %9.1f %9.1f\n", name, phase_name[p],
+                 t[p][n / 2], t[p][(n * 90) / 100], t[p][(n * 99) / 100],
+                 t[p][n - 1]);
+  }
+
+  (void)printf("%-36s %-6s %lu (children: %lu)\n", name, "calls", self,
+               children);
+}
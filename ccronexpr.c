@@ -30,6 +30,7 @@
 #include <math.h>
 
 #include "ccronexpr.h"
+#include "probe.h"
 
 #define CRON_MAX_SECONDS 60
 #define CRON_MAX_MINUTES 60
@@ -77,6 +78,17 @@ void* cron_malloc(size_t n);
 void cron_free(void* p);
 #endif /* CRON_TEST_MALLOC */
 
+/* opt-in counters: see cron_set_counters */
+static cron_counters* counters = NULL;
+static unsigned long depth = 0;
+
+#define CRON_COUNT(field) do { if (counters) counters->field++; } while (0)
+
+void cron_set_counters(cron_counters* c) {
+    counters = c;
+    depth = 0;
+}
+
 /**
  * Time functions from standard library.
  * This part defines: cron_mktime: create time_t from tm
@@ -171,6 +183,7 @@ struct tm* cron_time_local(time_t* date, struct tm* out) {
 /* Defining 'cron_' time functions to use use UTC (default) or local time */
 #ifndef CRON_USE_LOCAL_TIME
 time_t cron_mktime(struct tm* tm) {
+    CRON_COUNT(cron_mktime_calls);
     return cron_mktime_gm(tm);
 }
 
@@ -180,6 +193,7 @@ struct tm* cron_time(time_t* date, struct tm* out) {
 
 #else /* CRON_USE_LOCAL_TIME */
 time_t cron_mktime(struct tm* tm) {
+    CRON_COUNT(cron_mktime_calls);
     return cron_mktime_local(tm);
 }
 
@@ -245,6 +259,7 @@ static unsigned int next_set_bit(uint8_t* bits, unsigned int max, unsigned int f
         return 0;
     }
     for (i = from_index; i < max; i++) {
+        CRON_COUNT(next_set_bit_scans);
         if (cron_get_bit(bits, i)) return i;
     }
     *notfound = 1;
@@ -426,6 +441,7 @@ static unsigned int find_next_day(struct tm* calendar, uint8_t* days_of_month, u
     unsigned int count = 0;
     unsigned int max = 366;
     while ((!cron_get_bit(days_of_month, day_of_month) || !cron_get_bit(days_of_week, day_of_week)) && count++ < max) {
+        CRON_COUNT(find_next_day_iterations);
         err = add_to_field(calendar, CRON_CF_DAY_OF_MONTH, 1);
 
         if (err) goto return_error;
@@ -445,6 +461,10 @@ static int do_next(cron_expr* expr, struct tm* calendar, unsigned int dot) {
     int res = 0;
     int* resets = NULL;
     int* empty_list = NULL;
+    if (counters) {
+        counters->do_next_calls++;
+        if (++depth > counters->do_next_depth) counters->do_next_depth = depth;
+    }
     unsigned int second = 0;
     unsigned int update_second = 0;
     unsigned int minute = 0;
@@ -527,6 +547,7 @@ static int do_next(cron_expr* expr, struct tm* calendar, unsigned int dot) {
     if (empty_list) {
         cron_free(empty_list);
     }
+    if (counters) depth--;
     return res;
 }
 
@@ -978,7 +999,7 @@ void cron_parse_expr(const char* expression, cron_expr* target, const char** err
     free_splitted(fields, len);
 }
 
-time_t cron_next(cron_expr* expr, time_t date) {
+static time_t cron_next_date(cron_expr* expr, time_t date) {
     /*
      The plan:
 
@@ -1021,6 +1042,16 @@ time_t cron_next(cron_expr* expr, time_t date) {
     return cron_mktime(calendar);
 }
 
+time_t cron_next(cron_expr* expr, time_t date) {
+    time_t next;
+
+    PROBE1(cron_next__entry, date);
+    next = cron_next_date(expr, date);
+    PROBE2(cron_next__return, date, next);
+
+    return next;
+}
+
 
 /* https://github.com/staticlibs/ccronexpr/pull/8 */
 
@@ -1031,6 +1062,7 @@ static unsigned int prev_set_bit(uint8_t* bits, int from_index, int to_index, in
         return 0;
     }
     for (i = from_index; i >= to_index; i--) {
+        CRON_COUNT(next_set_bit_scans);
         if (cron_get_bit(bits, i)) return i;
     }
     *notfound = 1;
@@ -1141,6 +1173,7 @@ static unsigned int find_prev_day(struct tm* calendar, uint8_t* days_of_month, u
     unsigned int count = 0;
     unsigned int max = 366;
     while ((!cron_get_bit(days_of_month, day_of_month) || !cron_get_bit(days_of_week, day_of_week)) && count++ < max) {
+        CRON_COUNT(find_next_day_iterations);
         err = add_to_field(calendar, CRON_CF_DAY_OF_MONTH, -1);
 
         if (err) goto return_error;
@@ -1160,6 +1193,10 @@ static int do_prev(cron_expr* expr, struct tm* calendar, unsigned int dot) {
     int res = 0;
     int* resets = NULL;
     int* empty_list = NULL;
+    if (counters) {
+        counters->do_next_calls++;
+        if (++depth > counters->do_next_depth) counters->do_next_depth = depth;
+    }
     unsigned int second = 0;
     unsigned int update_second = 0;
     unsigned int minute = 0;
@@ -1242,6 +1279,7 @@ static int do_prev(cron_expr* expr, struct tm* calendar, unsigned int dot) {
     if (empty_list) {
         cron_free(empty_list);
     }
+    if (counters) depth--;
     return res;
 }
 
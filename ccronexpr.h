@@ -85,6 +85,28 @@ time_t cron_next(cron_expr* expr, time_t date);
  */
 time_t cron_prev(cron_expr* expr, time_t date);
 
+/**
+ * Counters for the work done by cron_next and cron_prev
+ */
+typedef struct {
+    /* calls to do_next/do_prev and the maximum recursion depth */
+    unsigned long do_next_calls;
+    unsigned long do_next_depth;
+    /* days tested by find_next_day/find_prev_day */
+    unsigned long find_next_day_iterations;
+    unsigned long cron_mktime_calls;
+    /* bits tested by next_set_bit/prev_set_bit */
+    unsigned long next_set_bit_scans;
+} cron_counters;
+
+/**
+ * Enables counting the work done by cron_next and cron_prev. Counters
+ * are added to the specified structure until disabled.
+ *
+ * @param counters counters to update, NULL to disable counting
+ */
+void cron_set_counters(cron_counters* counters);
+
 
 #if defined(__cplusplus) && !defined(CRON_COMPILE_AS_CXX)
 } /* extern "C"*/
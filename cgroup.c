@@ -0,0 +1,446 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cgroup.h"
+
+static int cgroup_delegated(void);
+static int cgroup_root(const char *path, char *root, size_t size);
+static int cgroup_self(char *buf, size_t size);
+static int cgroup_remove(void);
+static int cgroup_controller(const char *controller);
+static int cgroup_write(const char *file, const char *value);
+static int cgroup_file(const char *file, int flags);
+static ssize_t cgroup_read(int fd, char *buf, size_t size);
+static long long cgroup_value(const char *buf, const char *key);
+
+static char dir[PATH_MAX];
+
+/* cgroup.procs: joined by the task, read to signal the processes */
+static int procfd = -1;
+/* cgroup.kill: not available before Linux 5.14 */
+static int killfd = -1;
+static int freezefd = -1;
+static int cpufd = -1;
+static int memfd = -1;
+static int iofd = -1;
+
+int cgroup_open(const char *path, const char *memory_max, const char *cpu_max,
+                const char *io_max) {
+  int n;
+
+  n = snprintf(dir, sizeof(dir), "%s", path);
+  if (n < 0 || (size_t)n >= sizeof(dir)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  if (cgroup_delegated() < 0)
+    return -1;
+
+  /* controllers are enabled in the parent before creating the leaf */
+  if ((memory_max != NULL && cgroup_controller("+memory") < 0) ||
+      (cpu_max != NULL && cgroup_controller("+cpu") < 0) ||
+      (io_max != NULL && cgroup_controller("+io") < 0))
+    return -1;
+
+  if (mkdir(dir, 0755) < 0) {
+    if (errno != EEXIST)
+      return -1;
+
+    /* left by a previous run */
+    if (cgroup_remove() < 0 || mkdir(dir, 0755) < 0)
+      return -1;
+  }
+
+  if ((memory_max != NULL && cgroup_write("memory.max", memory_max) < 0) ||
+      (cpu_max != NULL && cgroup_write("cpu.max", cpu_max) < 0) ||
+      (io_max != NULL && cgroup_write("io.max", io_max) < 0))
+    return -1;
+
+  procfd = cgroup_file("cgroup.procs", O_RDWR);
+  if (procfd < 0)
+    return -1;
+
+  cpufd = cgroup_file("cpu.stat", O_RDONLY);
+  if (cpufd < 0)
+    return -1;
+
+  /* optional: depends on the kernel version and the enabled controllers */
+  killfd = cgroup_file("cgroup.kill", O_WRONLY);
+  freezefd = cgroup_file("cgroup.freeze", O_WRONLY);
+  memfd = cgroup_file("memory.peak", O_RDONLY);
+  iofd = cgroup_file("io.stat", O_RDONLY);
+
+  return 0;
+}
+
+/* Move the calling process into the leaf. */
+int cgroup_join(void) {
+  if (procfd < 0)
+    return 0;
+
+  return write(procfd, "0", 1) == 1 ? 0 : -1;
+}
+
+/* Signal every process in the leaf, including processes which have left
+ * the process group of the task. SIGKILL uses cgroup.kill if available.
+ * Returns -1 if the task is not running in a cgroup. */
+int cgroup_signal(int sig) {
+  char buf[4096];
+  pid_t pid = 0;
+  int digits = 0;
+  ssize_t n;
+  ssize_t i;
+
+  if (procfd < 0)
+    return -1;
+
+  if (sig == SIGKILL && killfd > -1)
+    return write(killfd, "1", 1) == 1 ? 0 : -1;
+
+  if (lseek(procfd, 0, SEEK_SET) < 0)
+    return -1;
+
+  /* a pid may be split between reads */
+  while ((n = read(procfd, buf, sizeof(buf))) != 0) {
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+
+    for (i = 0; i < n; i++) {
+      if (buf[i] >= '0' && buf[i] <= '9') {
+        pid = pid * 10 + (buf[i] - '0');
+        digits++;
+        continue;
+      }
+
+      if (digits > 0)
+        (void)kill(pid, sig);
+
+      pid = 0;
+      digits = 0;
+    }
+  }
+
+  if (digits > 0)
+    (void)kill(pid, sig);
+
+  return 0;
+}
+
+/* Freeze or thaw the processes in the leaf. Returns -1 if the task is not
+ * running in a cgroup. */
+int cgroup_freeze(int freeze) {
+  if (freezefd < 0)
+    return -1;
+
+  return write(freezefd, freeze ? "1" : "0", 1) == 1 ? 0 : -1;
+}
+
+/* Replace the resource usage of the task with the accounting of the leaf:
+ * CPU time from cpu.stat, the peak memory usage from memory.peak and the
+ * bytes read and written from io.stat (in 512 byte blocks). */
+int cgroup_rusage(struct rusage *ru) {
+  char buf[4096];
+  long long v;
+  char *p;
+  char *next;
+
+  if (procfd < 0)
+    return 0;
+
+  if (cgroup_read(cpufd, buf, sizeof(buf)) < 0)
+    return -1;
+
+  v = cgroup_value(buf, "user_usec ");
+  ru->ru_utime.tv_sec = v / 1000000;
+  ru->ru_utime.tv_usec = v % 1000000;
+
+  v = cgroup_value(buf, "system_usec ");
+  ru->ru_stime.tv_sec = v / 1000000;
+  ru->ru_stime.tv_usec = v % 1000000;
+
+  if (memfd > -1) {
+    if (cgroup_read(memfd, buf, sizeof(buf)) < 0)
+      return -1;
+    ru->ru_maxrss = strtoll(buf, NULL, 10) / 1024;
+  }
+
+  if (iofd > -1) {
+    long long rbytes = 0;
+    long long wbytes = 0;
+
+    if (cgroup_read(iofd, buf, sizeof(buf)) < 0)
+      return -1;
+
+    /* one line per device: MAJ:MIN rbytes=... wbytes=... */
+    for (p = buf; p != NULL; p = next) {
+      next = strchr(p, '\n');
+      if (next != NULL)
+        *next++ = '\0';
+      rbytes += cgroup_value(p, " rbytes=");
+      wbytes += cgroup_value(p, " wbytes=");
+    }
+
+    ru->ru_inblock = rbytes / 512;
+    ru->ru_oublock = wbytes / 512;
+  }
+
+  return 0;
+}
+
+/* The task moves itself into the leaf: the move requires write access to
+ * cgroup.procs in the common ancestor of the cgroup of runcron and the
+ * leaf. Fails with EPERM if runcron was not started in a cgroup allowed
+ * to move into the leaf, e.g., outside of the delegated subtree. */
+static int cgroup_delegated(void) {
+  char path[PATH_MAX];
+  char parent[PATH_MAX];
+  char root[PATH_MAX];
+  char self[PATH_MAX];
+  char cur[PATH_MAX];
+  size_t n = 0;
+  size_t i;
+  int rv;
+
+  (void)snprintf(path, sizeof(path), "%s", dir);
+  if (realpath(dirname(path), parent) == NULL)
+    return -1;
+
+  /* not available: the move into the leaf is checked when the task is
+   * started */
+  rv = cgroup_self(self, sizeof(self));
+  if (rv <= 0)
+    return rv;
+
+  if (cgroup_root(parent, root, sizeof(root)) < 0)
+    return -1;
+
+  rv = snprintf(cur, sizeof(cur), "%s%s", root,
+                strcmp(self, "/") == 0 ? "" : self);
+  if (rv < 0 || (size_t)rv >= sizeof(cur)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  /* longest common prefix ending on a path component */
+  for (i = 0; cur[i] != '\0' && cur[i] == parent[i]; i++) {
+    if (cur[i] == '/')
+      n = i;
+  }
+
+  if ((cur[i] == '\0' || cur[i] == '/') &&
+      (parent[i] == '\0' || parent[i] == '/'))
+    n = i;
+
+  rv = snprintf(path, sizeof(path), "%.*s/cgroup.procs", (int)n, cur);
+  if (rv < 0 || (size_t)rv >= sizeof(path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  if (faccessat(AT_FDCWD, path, W_OK, AT_EACCESS) < 0) {
+    if (errno == EACCES)
+      errno = EPERM;
+    return -1;
+  }
+
+  return 0;
+}
+
+/* Mount point of the cgroup file system containing path */
+static int cgroup_root(const char *path, char *root, size_t size) {
+  char up[PATH_MAX];
+  struct stat st;
+  dev_t dev;
+  char *p;
+
+  if (stat(path, &st) < 0)
+    return -1;
+
+  dev = st.st_dev;
+  (void)snprintf(root, size, "%s", path);
+
+  while (strcmp(root, "/") != 0) {
+    (void)snprintf(up, sizeof(up), "%s", root);
+    p = dirname(up);
+
+    if (stat(p, &st) < 0)
+      return -1;
+
+    if (st.st_dev != dev)
+      break;
+
+    (void)snprintf(root, size, "%s", p);
+  }
+
+  return 0;
+}
+
+/* cgroup v2 path of the calling process. Returns 0 if not available. */
+static int cgroup_self(char *buf, size_t size) {
+  char line[PATH_MAX + 4];
+  FILE *fp;
+  int rv = 0;
+  int n;
+
+  fp = fopen("/proc/self/cgroup", "r");
+  if (fp == NULL)
+    return 0;
+
+  while (fgets(line, sizeof(line), fp) != NULL) {
+    if (strncmp(line, "0::", 3) != 0)
+      continue;
+
+    line[strcspn(line, "\n")] = '\0';
+    n = snprintf(buf, size, "%s", line + 3);
+    if (n < 0 || (size_t)n >= size) {
+      errno = ENAMETOOLONG;
+      rv = -1;
+      break;
+    }
+    rv = 1;
+    break;
+  }
+
+  (void)fclose(fp);
+  return rv;
+}
+
+/* Kill any remaining processes and remove the leaf. Killing is
+ * asynchronous: the leaf cannot be removed until the processes have
+ * exited. */
+static int cgroup_remove(void) {
+  struct timespec ts = {0, 10 * 1000 * 1000};
+  int i;
+
+  if (rmdir(dir) == 0)
+    return 0;
+
+  if (errno != EBUSY)
+    return -1;
+
+  (void)cgroup_write("cgroup.kill", "1");
+
+  for (i = 0; i < 100; i++) {
+    if (rmdir(dir) == 0)
+      return 0;
+
+    if (errno != EBUSY)
+      return -1;
+
+    (void)nanosleep(&ts, NULL);
+  }
+
+  return -1;
+}
+
+static int cgroup_controller(const char *controller) {
+  char path[PATH_MAX];
+  char parent[PATH_MAX];
+  int fd;
+  int n;
+
+  (void)snprintf(parent, sizeof(parent), "%s", dir);
+
+  n = snprintf(path, sizeof(path), "%s/cgroup.subtree_control",
+               dirname(parent));
+  if (n < 0 || (size_t)n >= sizeof(path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  fd = open(path, O_WRONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+
+  n = write(fd, controller, strlen(controller));
+  (void)close(fd);
+
+  return n < 0 ? -1 : 0;
+}
+
+static int cgroup_write(const char *file, const char *value) {
+  ssize_t n;
+  int fd;
+
+  fd = cgroup_file(file, O_WRONLY);
+  if (fd < 0)
+    return -1;
+
+  n = write(fd, value, strlen(value));
+  (void)close(fd);
+
+  return n < 0 ? -1 : 0;
+}
+
+static int cgroup_file(const char *file, int flags) {
+  char path[PATH_MAX];
+  int n;
+
+  n = snprintf(path, sizeof(path), "%s/%s", dir, file);
+  if (n < 0 || (size_t)n >= sizeof(path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  return open(path, flags | O_CLOEXEC);
+}
+
+/* Read the contents of a cgroup file from the start. */
+static ssize_t cgroup_read(int fd, char *buf, size_t size) {
+  size_t len = 0;
+  ssize_t n;
+
+  if (lseek(fd, 0, SEEK_SET) < 0)
+    return -1;
+
+  while (len < size - 1 && (n = read(fd, buf + len, size - 1 - len)) != 0) {
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    len += (size_t)n;
+  }
+
+  buf[len] = '\0';
+  return (ssize_t)len;
+}
+
+/* Value following a key ("key value" or "key=value") or 0 */
+static long long cgroup_value(const char *buf, const char *key) {
+  const char *p;
+
+  p = strstr(buf, key);
+  if (p == NULL)
+    return 0;
+
+  return strtoll(p + strlen(key), NULL, 10);
+}
@@ -0,0 +1,30 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <sys/resource.h>
+
+/* cgroup v2: the task runs in a leaf cgroup created under a delegated
+ * parent. The leaf is recreated before each run. Resource limits are
+ * applied to the leaf and the accounting of the leaf replaces the
+ * resource usage of the task.
+ *
+ * cgroup_open() fails with EPERM if runcron is not running in the
+ * delegated subtree. */
+
+int cgroup_open(const char *path, const char *memory_max, const char *cpu_max,
+                const char *io_max);
+int cgroup_join(void);
+int cgroup_signal(int sig);
+int cgroup_freeze(int freeze);
+int cgroup_rusage(struct rusage *ru);
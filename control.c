@@ -0,0 +1,152 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "runcron.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "control.h"
+#ifndef HAVE_STRTONUM
+#include "strtonum.h"
+#endif
+
+static int control_listening(const struct sockaddr_un *sa);
+
+/* Create a listening Unix socket. A socket left by a previous
+ * instance is removed. Fails with EADDRINUSE if a process is listening
+ * on the socket. */
+int control_listen(const char *path) {
+  struct sockaddr_un sa = {0};
+  struct stat st;
+  int fd;
+
+  if (strlen(path) >= sizeof(sa.sun_path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  sa.sun_family = AF_UNIX;
+  (void)memcpy(sa.sun_path, path, strlen(path));
+
+  if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+    switch (control_listening(&sa)) {
+    case 0:
+      break;
+    case 1:
+      errno = EADDRINUSE;
+    /* fallthrough */
+    default:
+      return -1;
+    }
+
+    if (unlink(path) < 0 && errno != ENOENT)
+      return -1;
+  }
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+
+  if (fcntl(fd, F_SETFD, FD_CLOEXEC) < 0 ||
+      fcntl(fd, F_SETFL, O_NONBLOCK) < 0)
+    goto ERR;
+
+  if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+    goto ERR;
+
+  if (listen(fd, 16) < 0)
+    goto ERR;
+
+  return fd;
+
+ERR:
+  (void)close(fd);
+  return -1;
+}
+
+/* Parse a command line:
+ *
+ * status
+ * run-now
+ * skip-next
+ * postpone <seconds>
+ * cancel
+ *
+ * Returns the command or -1 if the command is invalid.
+ */
+int control_command(char *line, unsigned int *arg) {
+  const char *errstr = NULL;
+  char *p;
+
+  line[strcspn(line, "\r\n")] = '\0';
+
+  if (strcmp(line, "status") == 0)
+    return CONTROL_STATUS;
+
+  if (strcmp(line, "run-now") == 0)
+    return CONTROL_RUN_NOW;
+
+  if (strcmp(line, "skip-next") == 0)
+    return CONTROL_SKIP_NEXT;
+
+  if (strcmp(line, "cancel") == 0)
+    return CONTROL_CANCEL;
+
+  p = strchr(line, ' ');
+  if (p == NULL)
+    return -1;
+
+  *p++ = '\0';
+
+  if (strcmp(line, "postpone") == 0) {
+    *arg = strtonum(p, 1, INT_MAX, &errstr);
+    if (errstr != NULL)
+      return -1;
+    return CONTROL_POSTPONE;
+  }
+
+  return -1;
+}
+
+/* Returns 0 if the connection is refused: the socket was left by a
+ * process that has exited. The connection attempt does not block if the
+ * listen queue of the socket is full. */
+static int control_listening(const struct sockaddr_un *sa) {
+  int fd;
+  int rv = 1;
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+
+  if (fcntl(fd, F_SETFL, O_NONBLOCK) < 0) {
+    (void)close(fd);
+    return -1;
+  }
+
+  if (connect(fd, (const struct sockaddr *)sa, sizeof(*sa)) < 0 &&
+      (errno == ECONNREFUSED || errno == ENOENT))
+    rv = 0;
+
+  (void)close(fd);
+  return rv;
+}
@@ -30,6 +30,7 @@
 
 #include "cronevent.h"
 #include "limit_process.h"
+#include "probe.h"
 #include "restrict_process.h"
 #include "waitfor.h"
 
@@ -73,9 +74,17 @@ static struct runcron_alias {
 
 int cronevent(runcron_t *rp, char *cronentry, unsigned int *seconds,
               time_t now) {
-  return (rp->opt & OPT_DISABLE_PROCESS_RESTRICTIONS)
-             ? cronexpr(rp, cronentry, seconds, now)
-             : cronexpr_proc(rp, cronentry, seconds, now);
+  int rv;
+
+  PROBE2(cronevent__start, cronentry, now);
+
+  rv = (rp->opt & OPT_DISABLE_PROCESS_RESTRICTIONS)
+           ? cronexpr(rp, cronentry, seconds, now)
+           : cronexpr_proc(rp, cronentry, seconds, now);
+
+  PROBE3(cronevent__done, cronentry, rv, rv < 0 ? 0 : *seconds);
+
+  return rv;
 }
 
 static int cronexpr_proc(runcron_t *rp, char *cronentry, unsigned int *sec,
@@ -87,6 +96,9 @@ static int cronexpr_proc(runcron_t *rp, char *cronentry, unsigned int *sec,
   int exit_value = 0;
   int n;
   int fdp = -1;
+  sigset_t set;
+
+  (void)sigemptyset(&set);
 
   if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
     return -1;
@@ -106,6 +118,9 @@ static int cronexpr_proc(runcron_t *rp, char *cronentry, unsigned int *sec,
     return -1;
 
   case 0:
+    /* the supervisor may be blocking signals: SIGXCPU must be delivered */
+    if (sigprocmask(SIG_SETMASK, &set, NULL) < 0)
+      exit(111);
     if (close(sv[0]) < 0)
       exit(111);
     if (limit_process(rp) < 0)
@@ -126,12 +141,16 @@ static int cronexpr_proc(runcron_t *rp, char *cronentry, unsigned int *sec,
     _exit(0);
 
   default:
+    PROBE1(cronexpr__fork, pid);
+
     if (close(sv[1]) < 0)
       return -1;
 
-    if (waitfor(fdp, &status) < 0)
+    if (waitfor(pid, fdp, &status, NULL) < 0)
       return -1;
 
+    PROBE2(cronexpr__reap, pid, status);
+
     if (WIFEXITED(status))
       exit_value = WEXITSTATUS(status);
     else if (WIFSIGNALED(status))
@@ -177,6 +196,7 @@ static int cronexpr_proc(runcron_t *rp, char *cronentry, unsigned int *sec,
 static int cronexpr(runcron_t *rp, char *cronentry, unsigned int *seconds,
                     time_t now) {
   cron_expr expr = {0};
+  cron_counters counters = {0};
   const char *errbuf = NULL;
   char buf[255] = {0};
   char arg[252] = {0};
@@ -215,7 +235,21 @@ static int cronexpr(runcron_t *rp, char *cronentry, unsigned int *seconds,
     return -1;
   }
 
+  if (rp->verbose >= 3)
+    cron_set_counters(&counters);
+
   next = cron_next(&expr, now);
+
+  cron_set_counters(NULL);
+
+  if (rp->verbose >= 3)
+    (void)fprintf(stderr,
+                  "cron_next: calls=%lu depth=%lu days=%lu mktime=%lu "
+                  "bits=%lu\n",
+                  counters.do_next_calls, counters.do_next_depth,
+                  counters.find_next_day_iterations,
+                  counters.cron_mktime_calls, counters.next_set_bit_scans);
+
   if (next == -1) {
     warnx("error: cron_next: %s: %s", cronentry,
           errno == 0 ? "invalid timespec" : strerror(errno));
@@ -0,0 +1,999 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "runcron.h"
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/file.h>
+#include <sys/param.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/timerfd.h>
+#endif
+
+#include "cronevent.h"
+#include "crontab.h"
+#include "exit_status.h"
+#include "fnv1a.h"
+#include "priority.h"
+#include "probe.h"
+#include "randinit.h"
+#include "restrict_process.h"
+#include "set_env.h"
+#include "waitfor.h"
+#ifndef HAVE_SETPROCTITLE
+#include "setproctitle.h"
+#endif
+
+/* heap key of an entry that will not fire again */
+#define CRONTAB_NEVER ((time_t)-1)
+
+#define CRONTAB_SEPARATOR " \t"
+
+/* descriptors not used by entries: stdio, the clock and the exec pipe */
+#define CRONTAB_RESERVED_FILENO 16
+
+typedef struct {
+  char *timespec;
+  char *command;
+  char *file;
+  size_t line;
+  exit_status_t es;
+  int status;
+  unsigned int timeout;
+  pid_t pid;
+  /* time the task started */
+  struct timespec run;
+  /* idle: time of the next run, running: time the task is signalled */
+  time_t key;
+  /* --kill-after: the timeout signal was sent */
+  int timedout;
+  size_t pos;
+} crontab_entry_t;
+
+struct crontab {
+  char *path;
+  char *tag;
+  crontab_entry_t *entry;
+  size_t n;
+  /* min-heap of entries ordered by key */
+  crontab_entry_t **heap;
+  size_t running;
+  int exiting;
+  sigset_t mask;
+  /* detect changes to the system clock */
+  int clockfd;
+  struct timespec realtime;
+  struct timespec elapsed;
+  /* RLIMIT_NOFILE: restored in the task */
+  struct rlimit nofile;
+};
+
+static int crontab_parse(crontab_t *ct, FILE *fp);
+static int crontab_split(char *line, char **timespec, char **command);
+static int is_dow(const char *field);
+static int crontab_nofile(crontab_t *ct);
+static int crontab_lock(runcron_t *rp, crontab_t *ct, crontab_entry_t *e,
+                        char *file);
+static int crontab_next(runcron_t *rp, crontab_t *ct, crontab_entry_t *e,
+                        time_t now, unsigned int *seconds);
+static unsigned int crontab_interval(runcron_t *rp, crontab_entry_t *e,
+                                     unsigned int seconds);
+static int crontab_fire(runcron_t *rp, crontab_t *ct, crontab_entry_t *e,
+                        time_t now);
+static void crontab_reap(runcron_t *rp, crontab_t *ct, time_t now);
+static void crontab_print(crontab_t *ct, time_t now);
+static int crontab_clock_init(crontab_t *ct);
+static int crontab_clock(runcron_t *rp, crontab_t *ct, time_t now);
+#ifdef TFD_TIMER_CANCEL_ON_SET
+static int crontab_clock_arm(crontab_t *ct);
+#endif
+static int crontab_signal_init(crontab_t *ct);
+static void sa_handler_crontab(int sig, siginfo_t *info, void *context);
+
+static int heap_less(crontab_entry_t *a, crontab_entry_t *b);
+static void heap_swap(crontab_t *ct, size_t i, size_t j);
+static void heap_down(crontab_t *ct, size_t i);
+static void heap_update(crontab_t *ct, crontab_entry_t *e);
+
+static volatile sig_atomic_t crontab_sigchld = 0;
+static volatile sig_atomic_t crontab_runnow = 0;
+static volatile sig_atomic_t crontab_remaining = 0;
+static volatile sig_atomic_t crontab_terminate = 0;
+
+static const char *const days_of_week[] = {"SUN", "MON", "TUE", "WED",
+                                           "THU", "FRI", "SAT"};
+
+/* The schedule is calculated from now (the current time or --timestamp):
+ * t is the current time when now was read. */
+crontab_t *crontab_open(runcron_t *rp, char *path, char *file, char *tag,
+                        time_t now, time_t t) {
+  crontab_t *ct;
+  FILE *fp;
+  size_t i;
+
+  ct = calloc(1, sizeof(crontab_t));
+  if (ct == NULL)
+    return NULL;
+
+  ct->path = path;
+  ct->tag = tag;
+  ct->clockfd = -1;
+
+  fp = fopen(path, "r");
+  if (fp == NULL) {
+    warn("crontab: %s", path);
+    return NULL;
+  }
+
+  if (crontab_parse(ct, fp) < 0) {
+    (void)fclose(fp);
+    return NULL;
+  }
+
+  (void)fclose(fp);
+
+  if (ct->n == 0) {
+    warnx("crontab: %s: no entries", path);
+    return NULL;
+  }
+
+  if (crontab_nofile(ct) < 0)
+    return NULL;
+
+  /* the clock descriptor is opened before the lock files: pselect(2)
+   * is limited to descriptors below FD_SETSIZE */
+  if (crontab_clock_init(ct) < 0) {
+    warn("crontab: clock");
+    return NULL;
+  }
+
+  ct->heap = calloc(ct->n, sizeof(crontab_entry_t *));
+  if (ct->heap == NULL)
+    return NULL;
+
+  for (i = 0; i < ct->n; i++) {
+    crontab_entry_t *e = &ct->entry[i];
+    unsigned int seconds;
+
+    if (crontab_next(rp, ct, e, now, &seconds) < 0)
+      return NULL;
+
+    /* @reboot: if the state file doesn't exist, set the exit status
+     * to 255. */
+    if (seconds == UINT32_MAX)
+      e->status = 255;
+
+    if (crontab_lock(rp, ct, e, file) < 0)
+      return NULL;
+
+    /* @reboot: run immediately */
+    if (seconds == UINT32_MAX && e->status == 255)
+      seconds = 0;
+
+    seconds = crontab_interval(rp, e, seconds);
+
+    if (rp->opt & OPT_PRINT)
+      (void)printf("%lu\n", (long unsigned int)seconds);
+
+    e->key = seconds == UINT32_MAX ? CRONTAB_NEVER : t + seconds;
+    e->pos = i;
+    ct->heap[i] = e;
+  }
+
+  for (i = ct->n / 2; i > 0; i--)
+    heap_down(ct, i - 1);
+
+  return ct;
+}
+
+int crontab_run(runcron_t *rp, crontab_t *ct, char *procname) {
+  sigset_t omask;
+  time_t now;
+  size_t i;
+
+  if (crontab_signal_init(ct) < 0)
+    return -1;
+
+  if (sigprocmask(SIG_BLOCK, &ct->mask, &omask) < 0)
+    return -1;
+
+  for (;;) {
+    struct timespec realtime;
+    struct timespec ts = {0};
+    struct timespec *tsp = NULL;
+    crontab_entry_t *top;
+    fd_set rfds;
+
+    /* the wake up time is calculated from the sub-second wall clock:
+     * time(3) truncates the current time, delaying each run by up to a
+     * second */
+    if (clock_gettime(CLOCK_REALTIME, &realtime) < 0)
+      return -1;
+
+    now = realtime.tv_sec;
+
+    if (crontab_clock(rp, ct, now) < 0)
+      return -1;
+
+    if (crontab_sigchld) {
+      crontab_sigchld = 0;
+      crontab_reap(rp, ct, now);
+    }
+
+    if (crontab_terminate) {
+      if (ct->running == 0)
+        exit(111);
+
+      for (i = 0; i < ct->n; i++) {
+        if (ct->entry[i].pid > 0)
+          (void)kill(-ct->entry[i].pid, crontab_terminate);
+      }
+
+      crontab_terminate = 0;
+      ct->exiting = 1;
+    }
+
+    if (crontab_runnow) {
+      crontab_runnow = 0;
+      for (i = 0; i < ct->n; i++) {
+        crontab_entry_t *e = &ct->entry[i];
+        if (e->pid == 0 && !ct->exiting) {
+          e->key = now;
+          heap_update(ct, e);
+        }
+      }
+    }
+
+    if (crontab_remaining) {
+      crontab_remaining = 0;
+      crontab_print(ct, now);
+    }
+
+    while (ct->n > 0) {
+      top = ct->heap[0];
+      if (top->key == CRONTAB_NEVER || top->key > now)
+        break;
+
+      if (ct->exiting && top->pid == 0) {
+        top->key = CRONTAB_NEVER;
+      } else if (top->pid == 0) {
+        (void)crontab_fire(rp, ct, top, now);
+      } else if (!top->timedout) {
+        if (rp->verbose >= 1)
+          (void)fprintf(stderr, "%s: timeout: sending signal %d\n",
+                        top->command, rp->signal);
+        (void)kill(-top->pid, rp->signal);
+        /* --kill-after: the task may catch or ignore the timeout signal */
+        top->timedout = 1;
+        top->key = rp->kill_after > 0 ? now + rp->kill_after : CRONTAB_NEVER;
+      } else {
+        if (rp->verbose >= 1)
+          (void)fprintf(stderr, "%s: timeout: sending signal %d\n",
+                        top->command, SIGKILL);
+        (void)kill(-top->pid, SIGKILL);
+        top->key = CRONTAB_NEVER;
+      }
+
+      heap_update(ct, top);
+    }
+
+    if (ct->exiting && ct->running == 0)
+      exit(111);
+
+    top = ct->heap[0];
+    if (top->key != CRONTAB_NEVER) {
+      /* top->key > now: wake up at the start of the second */
+      ts.tv_sec = top->key - now - 1;
+      ts.tv_nsec = 1000000000L - realtime.tv_nsec;
+      if (ts.tv_nsec == 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec = 0;
+      }
+      tsp = &ts;
+    }
+
+    setproctitle(RUNCRON_TITLE, "crontab", tsp == NULL ? -1 : (int)ts.tv_sec,
+                 procname);
+
+    FD_ZERO(&rfds);
+    if (ct->clockfd > -1)
+      FD_SET(ct->clockfd, &rfds);
+
+    if (pselect(ct->clockfd + 1, &rfds, NULL, NULL, tsp, &omask) < 0 &&
+        errno != EINTR)
+      return -1;
+  }
+}
+
+static int crontab_parse(crontab_t *ct, FILE *fp) {
+  char *buf = NULL;
+  size_t buflen = 0;
+  size_t size = 0;
+  size_t line = 0;
+
+  while (getline(&buf, &buflen, fp) != -1) {
+    crontab_entry_t *e;
+    char *timespec;
+    char *command;
+
+    line++;
+
+    if (crontab_split(buf, &timespec, &command) < 0) {
+      warnx("crontab: %s:%zu: invalid entry", ct->path, line);
+      goto ERR;
+    }
+
+    if (timespec == NULL)
+      continue;
+
+    if (ct->n == size) {
+      crontab_entry_t *entry;
+
+      size = size == 0 ? 16 : size * 2;
+      if (size > SIZE_MAX / sizeof(crontab_entry_t))
+        goto ERR;
+      entry = realloc(ct->entry, size * sizeof(crontab_entry_t));
+      if (entry == NULL)
+        goto ERR;
+      ct->entry = entry;
+    }
+
+    e = &ct->entry[ct->n];
+    (void)memset(e, 0, sizeof(crontab_entry_t));
+    e->line = line;
+    e->es.fd = -1;
+    e->timespec = strdup(timespec);
+    e->command = strdup(command);
+    if (e->timespec == NULL || e->command == NULL)
+      goto ERR;
+
+    ct->n++;
+  }
+
+  if (ferror(fp)) {
+    warn("crontab: %s", ct->path);
+    goto ERR;
+  }
+
+  free(buf);
+  return 0;
+
+ERR:
+  free(buf);
+  return -1;
+}
+
+/* Split a crontab line into the timespec and the command. Blank lines and
+ * comments set timespec to NULL.
+ *
+ * The timespec is either an alias (@daily) or 5 fields. A sixth field is
+ * part of the timespec if it is a valid day of week field: to run a
+ * command named like a day of week field, use a 6 field timespec. */
+static int crontab_split(char *line, char **timespec, char **command) {
+  char *p = line;
+  char *end;
+  int fields;
+  int i;
+
+  *timespec = NULL;
+  *command = NULL;
+
+  line[strcspn(line, "\r\n")] = '\0';
+
+  p += strspn(p, CRONTAB_SEPARATOR);
+  if (*p == '\0' || *p == '#')
+    return 0;
+
+  fields = (*p == '@' || *p == '=') ? 1 : 5;
+
+  end = p;
+  for (i = 0; i < fields; i++) {
+    end += strspn(end, CRONTAB_SEPARATOR);
+    if (*end == '\0')
+      return -1;
+    end += strcspn(end, CRONTAB_SEPARATOR);
+  }
+
+  if (fields == 5) {
+    char *next = end + strspn(end, CRONTAB_SEPARATOR);
+    size_t len = strcspn(next, CRONTAB_SEPARATOR);
+    char field[64] = {0};
+
+    if (len > 0 && len < sizeof(field)) {
+      (void)memcpy(field, next, len);
+      if (is_dow(field))
+        end = next + len;
+    }
+  }
+
+  if (*end == '\0')
+    return -1;
+
+  *end++ = '\0';
+  end += strspn(end, CRONTAB_SEPARATOR);
+  if (*end == '\0')
+    return -1;
+
+  *timespec = p;
+  *command = end;
+  return 0;
+}
+
+static int is_dow(const char *field) {
+  const char *p = field;
+
+  while (*p != '\0') {
+    size_t len = strcspn(p, ",-/~#");
+    size_t i;
+
+    if (len == 0) {
+      p++;
+      continue;
+    }
+
+    if (strspn(p, "0123456789*?LW") < len) {
+      for (i = 0; i < sizeof(days_of_week) / sizeof(days_of_week[0]); i++) {
+        if (len == 3 && strncasecmp(p, days_of_week[i], 3) == 0)
+          break;
+      }
+      if (i == sizeof(days_of_week) / sizeof(days_of_week[0]))
+        return 0;
+    }
+
+    p += len;
+  }
+
+  return 1;
+}
+
+/* The lock on the state file of each entry is held for the life of the
+ * process: the soft limit on open files is raised to the hard limit. */
+static int crontab_nofile(crontab_t *ct) {
+  struct rlimit rl;
+
+  if (getrlimit(RLIMIT_NOFILE, &rl) < 0) {
+    warn("crontab: getrlimit");
+    return -1;
+  }
+
+  ct->nofile = rl;
+
+  if (rl.rlim_cur != rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    /* the hard limit may be unlimited (e.g., OPEN_MAX on macOS) */
+    if (setrlimit(RLIMIT_NOFILE, &rl) < 0)
+      rl = ct->nofile;
+  }
+
+  if (rl.rlim_cur != RLIM_INFINITY &&
+      (rl.rlim_cur < CRONTAB_RESERVED_FILENO ||
+       ct->n > rl.rlim_cur - CRONTAB_RESERVED_FILENO)) {
+    warnx("crontab: %s: %zu entries: exceeds open file limit (%llu)",
+          ct->path, ct->n, (unsigned long long)rl.rlim_cur);
+    return -1;
+  }
+
+  return 0;
+}
+
+static int crontab_lock(runcron_t *rp, crontab_t *ct, crontab_entry_t *e,
+                        char *file) {
+  char *s;
+  uint32_t hash;
+  size_t len;
+  int rv;
+
+  len = strlen(e->timespec) + 1 + strlen(e->command) + 1;
+  s = malloc(len);
+  if (s == NULL)
+    return -1;
+
+  rv = snprintf(s, len, "%s %s", e->timespec, e->command);
+  if (rv < 0 || (unsigned)rv >= len) {
+    free(s);
+    return -1;
+  }
+
+  hash = fnv1a((uint8_t *)s, (size_t)rv);
+  free(s);
+
+  len = strlen(file) + 1 + 8 + 1;
+  e->file = malloc(len);
+  if (e->file == NULL)
+    return -1;
+
+  rv = snprintf(e->file, len, "%s.%08x", file, hash);
+  if (rv < 0 || (unsigned)rv >= len)
+    return -1;
+
+  if (open_exit_status(e->file, &e->es, rp->state_sync, &e->status) < 0) {
+    warn("crontab: %s:%zu: open_exit_status: %s", ct->path, e->line, e->file);
+    return -1;
+  }
+
+  if (!(rp->opt & OPT_DRYRUN) && (flock(e->es.fd, LOCK_EX | LOCK_NB) < 0)) {
+    warn("crontab: %s:%zu: flock: %s", ct->path, e->line, e->file);
+    return -1;
+  }
+
+  return 0;
+}
+
+/* The random offset of an entry is seeded from the tag as if the entry was
+ * run by a standalone runcron. */
+static int crontab_next(runcron_t *rp, crontab_t *ct, crontab_entry_t *e,
+                        time_t now, unsigned int *seconds) {
+  if (randinit(ct->tag) < 0)
+    return -1;
+
+  if (cronevent(rp, e->timespec, seconds, now) < 0) {
+    warnx("crontab: %s:%zu: %s", ct->path, e->line, e->timespec);
+    return -1;
+  }
+
+  return 0;
+}
+
+static unsigned int crontab_interval(runcron_t *rp, crontab_entry_t *e,
+                                     unsigned int seconds) {
+  /* @reboot: sleep indefinitely after the task succeeds */
+  if (e->status != 0 && seconds > rp->retry_interval)
+    seconds = rp->retry_interval;
+
+  if (rp->verbose >= 1)
+    (void)fprintf(stderr,
+                  "%s: last exit status was %d, sleep interval is %us\n",
+                  e->command, e->status, seconds);
+
+  return seconds;
+}
+
+static int crontab_fire(runcron_t *rp, crontab_t *ct, crontab_entry_t *e,
+                        time_t now) {
+  unsigned int timeout = rp->timeout;
+  exit_status_record_t last;
+  struct timespec wake;
+  struct timespec forked;
+  struct timespec exec;
+  int64_t lag;
+  int execfd[2];
+  int error;
+  pid_t pid;
+  int fd;
+  const char *call;
+
+  if (clock_gettime(CLOCK_REALTIME, &wake) < 0) {
+    call = "clock_gettime";
+    goto ERR;
+  }
+
+  /* the run was scheduled for e->key */
+  lag = (int64_t)(wake.tv_sec - e->key) * 1000000 + wake.tv_nsec / 1000;
+
+  if (timeout == 0) {
+    if (randinit(ct->tag) < 0 || cronevent(rp, e->timespec, &timeout, now) < 0)
+      timeout = UINT32_MAX;
+  }
+
+  if (e->status == 0) {
+    if (write_exit_status(&e->es, 128 + SIGKILL) < 0)
+      warn("crontab: write_exit_status: %s", e->file);
+  }
+
+  if (clock_gettime(RUNCRON_CLOCK_ELAPSED, &e->run) < 0) {
+    call = "clock_gettime";
+    goto ERR;
+  }
+
+  exit_status_start(&e->es, now);
+  (void)read_exit_status(&e->es, &last);
+
+  if (sync_exit_status(&e->es, EXIT_STATUS_SYNC_FULL) < 0)
+    warn("crontab: sync_exit_status: %s", e->file);
+
+  if (execpipe(execfd) < 0) {
+    call = "execpipe";
+    goto ERR;
+  }
+
+  pid = fork();
+
+  switch (pid) {
+  case -1:
+    error = errno;
+    (void)close(execfd[0]);
+    (void)close(execfd[1]);
+    errno = error;
+    call = "fork";
+    goto ERR;
+
+  case 0:
+    if (sigprocmask(SIG_UNBLOCK, &ct->mask, NULL) < 0)
+      _exit(111);
+
+    if (setsid() < 0)
+      _exit(111);
+
+    if (restrict_process_signal_on_supervisor_exit() < 0)
+      _exit(111);
+
+    if (priority_apply() < 0)
+      _exit(111);
+
+    if ((set_env("RUNCRON_TIMEOUT", timeout) < 0) ||
+        (set_env("RUNCRON_EXITSTATUS", e->status) < 0) ||
+        (exit_status_env(&last) < 0))
+      _exit(111);
+
+    fd = open("/dev/null", O_RDONLY);
+    if (fd < 0 || dup2(fd, STDIN_FILENO) < 0)
+      _exit(111);
+
+    if (fd != STDIN_FILENO)
+      (void)close(fd);
+
+    /* the descriptors above the limit are the lock files (close-on-exec) */
+    if (setrlimit(RLIMIT_NOFILE, &ct->nofile) < 0)
+      _exit(111);
+
+    (void)execl("/bin/sh", "sh", "-c", e->command, (char *)NULL);
+    error = errno;
+    while (write(execfd[1], &error, sizeof(error)) < 0 && errno == EINTR)
+      ;
+    _exit(error == ENOENT ? 127 : 126);
+
+  default:
+    break;
+  }
+
+  (void)clock_gettime(RUNCRON_CLOCK_ELAPSED, &forked);
+  (void)close(execfd[1]);
+
+  PROBE1(task__fork, pid);
+
+  error = waitexec(execfd[0]);
+  (void)close(execfd[0]);
+
+  PROBE3(task__exec, pid, error, lag);
+
+  (void)clock_gettime(RUNCRON_CLOCK_ELAPSED, &exec);
+
+  exit_status_latency(&e->es, lag, RUNCRON_USEC(e->run, forked),
+                      RUNCRON_USEC(forked, exec));
+
+  if (rp->verbose >= 1) {
+    (void)fprintf(stderr, "%s: started: lag=%lldus fork=%lldus exec=%lldus\n",
+                  e->command, (long long)lag,
+                  (long long)RUNCRON_USEC(e->run, forked),
+                  (long long)RUNCRON_USEC(forked, exec));
+    if (error > 0)
+      (void)fprintf(stderr, "%s: exec: %s\n", e->command, strerror(error));
+  }
+
+  if (rp->verbose >= 1)
+    (void)fprintf(stderr, "%s: running command: timeout is set to %us\n",
+                  e->command, timeout);
+
+  e->pid = pid;
+  e->timeout = timeout;
+  e->key = timeout == UINT32_MAX ? CRONTAB_NEVER : now + timeout;
+  ct->running++;
+
+  return 0;
+
+ERR:
+  /* the entry is retried: the key must be advanced or the entry is fired
+   * again immediately */
+  warn("crontab: %s:%zu: %s", ct->path, e->line, call);
+  e->key = now + MAX(rp->retry_interval, 1);
+  return -1;
+}
+
+static void crontab_reap(runcron_t *rp, crontab_t *ct, time_t now) {
+  exit_status_record_t last;
+  struct rusage ru;
+  struct timespec ts;
+  pid_t pid;
+  int status;
+  size_t i;
+
+  while ((pid = wait4(-1, &status, WNOHANG, &ru)) > 0) {
+    crontab_entry_t *e = NULL;
+    unsigned int seconds;
+    int exit_value = 0;
+
+    for (i = 0; i < ct->n; i++) {
+      if (ct->entry[i].pid == pid) {
+        e = &ct->entry[i];
+        break;
+      }
+    }
+
+    if (e == NULL)
+      continue;
+
+    if (WIFEXITED(status))
+      exit_value = WEXITSTATUS(status);
+    else if (WIFSIGNALED(status))
+      exit_value = 128 + WTERMSIG(status);
+
+    if (rp->verbose >= 3)
+      (void)fprintf(stderr, "%s: status=%d exit_value=%d\n", e->command,
+                    status, exit_value);
+
+    if (clock_gettime(RUNCRON_CLOCK_ELAPSED, &ts) == 0)
+      exit_status_end(&e->es, now,
+                      (int64_t)(ts.tv_sec - e->run.tv_sec) * 1000 +
+                          (ts.tv_nsec - e->run.tv_nsec) / 1000000,
+                      status, &ru);
+
+    if (rp->verbose >= 1 && read_exit_status(&e->es, &last) == 0)
+      (void)fprintf(stderr,
+                    "%s: command exited: status=%d wall=%lldms utime=%lldms "
+                    "stime=%lldms maxrss=%lldkB inblock=%lld oublock=%lld "
+                    "nvcsw=%lld nivcsw=%lld\n",
+                    e->command, exit_value, (long long)last.wall,
+                    (long long)(last.utime / 1000),
+                    (long long)(last.stime / 1000), (long long)last.maxrss,
+                    (long long)last.inblock, (long long)last.oublock,
+                    (long long)last.nvcsw, (long long)last.nivcsw);
+
+    if (write_exit_status(&e->es, exit_value) < 0)
+      warn("crontab: write_exit_status: %s", e->file);
+
+    if (sync_exit_status(&e->es, EXIT_STATUS_SYNC_DATA) < 0)
+      warn("crontab: sync_exit_status: %s", e->file);
+
+    if (!(rp->opt & OPT_DISABLE_SIGNAL_ON_EXIT))
+      (void)kill(-pid, rp->signal);
+
+    e->pid = 0;
+    e->timedout = 0;
+    e->status = exit_value;
+    ct->running--;
+
+    if (ct->exiting) {
+      e->key = CRONTAB_NEVER;
+    } else if (crontab_next(rp, ct, e, now, &seconds) < 0) {
+      e->key = now + rp->retry_interval;
+    } else {
+      seconds = crontab_interval(rp, e, seconds);
+      e->key = seconds == UINT32_MAX ? CRONTAB_NEVER : now + seconds;
+    }
+
+    heap_update(ct, e);
+  }
+}
+
+static void crontab_print(crontab_t *ct, time_t now) {
+  size_t i;
+
+  for (i = 0; i < ct->n; i++) {
+    crontab_entry_t *e = &ct->entry[i];
+
+    if (e->key == CRONTAB_NEVER)
+      (void)fprintf(stderr, "%s:%zu: %s\n", ct->path, e->line,
+                    e->pid > 0 ? "running" : "never");
+    else
+      (void)fprintf(stderr, "%s:%zu: %s %lld\n", ct->path, e->line,
+                    e->pid > 0 ? "running" : "sleep",
+                    (long long)(e->key > now ? e->key - now : 0));
+  }
+}
+
+static int crontab_clock_init(crontab_t *ct) {
+  if (clock_gettime(CLOCK_REALTIME, &ct->realtime) < 0 ||
+      clock_gettime(RUNCRON_CLOCK_ELAPSED, &ct->elapsed) < 0)
+    return -1;
+
+#ifdef TFD_TIMER_CANCEL_ON_SET
+  /* Wake up when the clock is set: the timer is armed far in the future
+   * and is cancelled if the clock changes. */
+  ct->clockfd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (ct->clockfd < 0)
+    return -1;
+
+  return crontab_clock_arm(ct);
+#else
+  return 0;
+#endif
+}
+
+#ifdef TFD_TIMER_CANCEL_ON_SET
+static int crontab_clock_arm(crontab_t *ct) {
+  struct itimerspec it = {0};
+
+  it.it_value.tv_sec = ct->realtime.tv_sec + 365 * 24 * 60 * 60;
+
+  return timerfd_settime(ct->clockfd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                         &it, NULL);
+}
+#endif
+
+/* Compare the wall clock with the elapsed time since the last check. If the
+ * system clock was changed, calculate the next run of idle entries from the
+ * current time. Retry intervals and task timeouts are durations and are
+ * moved by the size of the change. */
+static int crontab_clock(runcron_t *rp, crontab_t *ct, time_t now) {
+  struct timespec realtime;
+  struct timespec elapsed;
+  long long jump;
+  size_t i;
+
+#ifdef TFD_TIMER_CANCEL_ON_SET
+  uint64_t expired;
+
+  if (read(ct->clockfd, &expired, sizeof(expired)) < 0) {
+    if (errno != EAGAIN && errno != ECANCELED)
+      return -1;
+    if (errno == ECANCELED && crontab_clock_arm(ct) < 0)
+      return -1;
+  } else if (crontab_clock_arm(ct) < 0) {
+    return -1;
+  }
+#endif
+
+  if (clock_gettime(CLOCK_REALTIME, &realtime) < 0 ||
+      clock_gettime(RUNCRON_CLOCK_ELAPSED, &elapsed) < 0)
+    return -1;
+
+  jump = ((long long)(realtime.tv_sec - ct->realtime.tv_sec) * 1000 +
+          (realtime.tv_nsec - ct->realtime.tv_nsec) / 1000000) -
+         ((long long)(elapsed.tv_sec - ct->elapsed.tv_sec) * 1000 +
+          (elapsed.tv_nsec - ct->elapsed.tv_nsec) / 1000000);
+
+  ct->realtime = realtime;
+  ct->elapsed = elapsed;
+
+  if (jump > -1000 && jump < 1000)
+    return 0;
+
+  jump /= 1000;
+
+  if (rp->verbose >= 1)
+    (void)fprintf(stderr, "crontab: clock changed by %+llds\n", jump);
+
+  for (i = 0; i < ct->n; i++) {
+    crontab_entry_t *e = &ct->entry[i];
+    unsigned int seconds;
+
+    if (e->key == CRONTAB_NEVER && e->pid == 0)
+      continue;
+
+    if (e->pid > 0 || e->status != 0) {
+      if (e->key != CRONTAB_NEVER)
+        e->key += jump;
+      continue;
+    }
+
+    if (crontab_next(rp, ct, e, now, &seconds) < 0)
+      return -1;
+
+    e->key = seconds == UINT32_MAX ? CRONTAB_NEVER : now + seconds;
+  }
+
+  for (i = ct->n / 2; i > 0; i--)
+    heap_down(ct, i - 1);
+
+  return 0;
+}
+
+static int crontab_signal_init(crontab_t *ct) {
+  struct sigaction act = {0};
+  int sig;
+
+  act.sa_flags |= SA_SIGINFO;
+  act.sa_sigaction = sa_handler_crontab;
+  (void)sigfillset(&act.sa_mask);
+
+  (void)sigemptyset(&ct->mask);
+
+  for (sig = 1; sig < NSIG; sig++) {
+    if (sigaction(sig, &act, NULL) < 0) {
+      if (errno == EINVAL)
+        continue;
+
+      return -1;
+    }
+
+    (void)sigaddset(&ct->mask, sig);
+  }
+
+  return 0;
+}
+
+static void sa_handler_crontab(int sig, siginfo_t *info, void *context) {
+  switch (sig) {
+  case SIGCHLD:
+    crontab_sigchld = 1;
+    break;
+  case SIGUSR1:
+  case SIGALRM:
+    crontab_runnow = 1;
+    break;
+  case SIGUSR2:
+    crontab_remaining = 1;
+    break;
+  case SIGHUP:
+  case SIGINT:
+  case SIGQUIT:
+  case SIGTERM:
+    crontab_terminate = sig;
+    break;
+  default:
+    break;
+  }
+}
+
+static int heap_less(crontab_entry_t *a, crontab_entry_t *b) {
+  if (a->key == CRONTAB_NEVER)
+    return 0;
+  if (b->key == CRONTAB_NEVER)
+    return 1;
+  return a->key < b->key;
+}
+
+static void heap_swap(crontab_t *ct, size_t i, size_t j) {
+  crontab_entry_t *e = ct->heap[i];
+
+  ct->heap[i] = ct->heap[j];
+  ct->heap[j] = e;
+  ct->heap[i]->pos = i;
+  ct->heap[j]->pos = j;
+}
+
+static void heap_down(crontab_t *ct, size_t i) {
+  for (;;) {
+    size_t l = 2 * i + 1;
+    size_t r = l + 1;
+    size_t min = i;
+
+    if (l < ct->n && heap_less(ct->heap[l], ct->heap[min]))
+      min = l;
+    if (r < ct->n && heap_less(ct->heap[r], ct->heap[min]))
+      min = r;
+    if (min == i)
+      break;
+
+    heap_swap(ct, i, min);
+    i = min;
+  }
+}
+
+/* Restore the heap property after the key of an entry has changed. */
+static void heap_update(crontab_t *ct, crontab_entry_t *e) {
+  size_t i = e->pos;
+
+  while (i > 0 && heap_less(ct->heap[i], ct->heap[(i - 1) / 2])) {
+    heap_swap(ct, i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+
+  heap_down(ct, i);
+}
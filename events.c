@@ -0,0 +1,103 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "runcron.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "events.h"
+
+static int eventfd = -1;
+static char buf[4096];
+static size_t len;
+
+int events_open(int fd) {
+  /* the descriptor is not passed to the task */
+  if (fcntl(fd, F_SETFD, FD_CLOEXEC) < 0)
+    return -1;
+
+  eventfd = fd;
+  return 0;
+}
+
+/* Buffer an event: fmt formats the remaining members of the object, e.g.
+ * ",\"pid\":%d". */
+void events_emit(const char *event, const char *fmt, ...) {
+  struct timespec monotonic;
+  struct timespec realtime;
+  va_list ap;
+  size_t off;
+  int n;
+
+  if (eventfd < 0)
+    return;
+
+  (void)clock_gettime(CLOCK_MONOTONIC, &monotonic);
+  (void)clock_gettime(CLOCK_REALTIME, &realtime);
+
+  for (;;) {
+    off = len;
+
+    n = snprintf(buf + off, sizeof(buf) - off,
+                 "{\"event\":\"%s\",\"monotonic\":%lld.%09ld,"
+                 "\"realtime\":%lld.%09ld",
+                 event, (long long)monotonic.tv_sec, monotonic.tv_nsec,
+                 (long long)realtime.tv_sec, realtime.tv_nsec);
+    if (n >= 0 && (size_t)n < sizeof(buf) - off) {
+      off += (size_t)n;
+
+      if (fmt != NULL) {
+        va_start(ap, fmt);
+        n = vsnprintf(buf + off, sizeof(buf) - off, fmt, ap);
+        va_end(ap);
+        if (n >= 0)
+          off += (size_t)n;
+      }
+
+      if (n >= 0 && off + 2 <= sizeof(buf)) {
+        buf[off++] = '}';
+        buf[off++] = '\n';
+        len = off;
+        return;
+      }
+    }
+
+    /* the buffer is full: discard the partial event */
+    if (len == 0)
+      return;
+
+    events_flush();
+  }
+}
+
+void events_flush(void) {
+  size_t off = 0;
+  ssize_t n;
+
+  while (off < len) {
+    n = write(eventfd, buf + off, len - off);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+    off += (size_t)n;
+  }
+
+  len = 0;
+}
@@ -0,0 +1,317 @@
+/* Copyright (c) 2019-2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "exit_status.h"
+#include "probe.h"
+#include "set_env.h"
+
+static int map_exit_status(exit_status_t *es);
+static int alloc_exit_status(int fd, off_t size, off_t len);
+static int sync_dir(const char *file);
+static int cmp_history(const void *a, const void *b);
+
+static const char *const sync_modes[] = {"none", "data", "full", NULL};
+
+int exit_status_sync_mode(const char *mode) {
+  int i;
+
+  for (i = 0; sync_modes[i] != NULL; i++) {
+    if (strcmp(mode, sync_modes[i]) == 0)
+      return i;
+  }
+
+  return -1;
+}
+
+/* Open the lock file and map the job state. A file using the 1 byte
+ * format is extended: the exit status is preserved. */
+int open_exit_status(char *file, exit_status_t *es, int sync, int *status) {
+  es->map = NULL;
+  es->sync = sync;
+
+  es->fd = open(file, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+
+  if (es->fd < 0) {
+    switch (errno) {
+    case EEXIST:
+      es->fd = open(file, O_RDWR | O_CLOEXEC, 0);
+      if (es->fd < 0)
+        return -1;
+      if (map_exit_status(es) < 0) {
+        (void)close(es->fd);
+        return -1;
+      }
+      *status = es->map->status;
+      return es->fd;
+    default:
+      return -1;
+    }
+  }
+
+  if (map_exit_status(es) < 0 || write_exit_status(es, *status) < 0) {
+    (void)close(es->fd);
+    return -1;
+  }
+
+  if (es->sync == EXIT_STATUS_SYNC_FULL &&
+      (fsync(es->fd) < 0 || sync_dir(file) < 0)) {
+    (void)close(es->fd);
+    return -1;
+  }
+
+  return es->fd;
+}
+
+/* Flush the state to disk if the sync mode is at least level. */
+int sync_exit_status(exit_status_t *es, int level) {
+  if (es->sync < level)
+    return 0;
+
+  return msync(es->map, sizeof(exit_status_file_t), MS_SYNC);
+}
+
+int write_exit_status(exit_status_t *es, int status) {
+  es->map->status = status > 255 ? 128 : (unsigned char)status;
+  PROBE1(state__status, status);
+  return 0;
+}
+
+/* Copy the current record. */
+int read_exit_status(exit_status_t *es, exit_status_record_t *rec) {
+  uint32_t generation;
+
+  do {
+    generation = __atomic_load_n(&es->map->generation, __ATOMIC_ACQUIRE);
+    (void)memcpy(rec, &es->map->slot[generation & 1], sizeof(*rec));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while (generation !=
+           __atomic_load_n(&es->map->generation, __ATOMIC_RELAXED));
+
+  return 0;
+}
+
+/* Write the record to the unused slot and make it current. */
+int write_exit_record(exit_status_t *es, const exit_status_record_t *rec) {
+  uint32_t generation = es->map->generation;
+
+  (void)memcpy(&es->map->slot[(generation + 1) & 1], rec, sizeof(*rec));
+  __atomic_store_n(&es->map->generation, generation + 1, __ATOMIC_RELEASE);
+  PROBE1(state__record, generation + 1);
+
+  return 0;
+}
+
+void exit_status_start(exit_status_t *es, time_t start) {
+  exit_status_record_t rec;
+
+  (void)read_exit_status(es, &rec);
+  rec.start = start;
+  (void)write_exit_record(es, &rec);
+}
+
+void exit_status_latency(exit_status_t *es, int64_t lag, int64_t fork,
+                         int64_t exec) {
+  exit_status_record_t rec;
+
+  (void)read_exit_status(es, &rec);
+  rec.lag = lag;
+  rec.fork = fork;
+  rec.exec = exec;
+  (void)write_exit_record(es, &rec);
+}
+
+void exit_status_deferred(exit_status_t *es, uint32_t deferred) {
+  exit_status_record_t rec;
+
+  (void)read_exit_status(es, &rec);
+  rec.deferred = deferred;
+  (void)write_exit_record(es, &rec);
+}
+
+/* Record the result of a run: status is the status returned by wait(2),
+ * wall is the run time in milliseconds. */
+void exit_status_end(exit_status_t *es, time_t end, int64_t wall, int status,
+                     const struct rusage *ru) {
+  exit_status_record_t rec;
+
+  (void)read_exit_status(es, &rec);
+
+  rec.end = end;
+  rec.wall = wall;
+  rec.signal = 0;
+
+  if (WIFEXITED(status)) {
+    rec.status = WEXITSTATUS(status);
+  } else if (WIFSIGNALED(status)) {
+    rec.signal = WTERMSIG(status);
+    rec.status = 128 + rec.signal;
+  }
+
+  rec.failures = rec.status == 0 ? 0 : rec.failures + 1;
+
+  if (rec.status == 0) {
+    es->map->history[es->map->runs % EXIT_STATUS_HISTORY] =
+        wall > UINT32_MAX ? UINT32_MAX : (uint32_t)(wall < 0 ? 0 : wall);
+    es->map->runs++;
+  }
+
+  if (ru != NULL) {
+    rec.utime = (int64_t)ru->ru_utime.tv_sec * 1000000 + ru->ru_utime.tv_usec;
+    rec.stime = (int64_t)ru->ru_stime.tv_sec * 1000000 + ru->ru_stime.tv_usec;
+    rec.maxrss = ru->ru_maxrss;
+    rec.inblock = ru->ru_inblock;
+    rec.oublock = ru->ru_oublock;
+    rec.nvcsw = ru->ru_nvcsw;
+    rec.nivcsw = ru->ru_nivcsw;
+  }
+
+  (void)write_exit_record(es, &rec);
+}
+
+/* Export the resource usage of the last run to the task environment. CPU
+ * time is in milliseconds. */
+int exit_status_env(const exit_status_record_t *rec) {
+  if ((set_env_int64("RUNCRON_LAST_WALL", rec->wall) < 0) ||
+      (set_env_int64("RUNCRON_LAST_UTIME", rec->utime / 1000) < 0) ||
+      (set_env_int64("RUNCRON_LAST_STIME", rec->stime / 1000) < 0) ||
+      (set_env_int64("RUNCRON_LAST_MAXRSS", rec->maxrss) < 0) ||
+      (set_env_int64("RUNCRON_LAST_INBLOCK", rec->inblock) < 0) ||
+      (set_env_int64("RUNCRON_LAST_OUBLOCK", rec->oublock) < 0) ||
+      (set_env_int64("RUNCRON_LAST_NVCSW", rec->nvcsw) < 0) ||
+      (set_env_int64("RUNCRON_LAST_NIVCSW", rec->nivcsw) < 0))
+    return -1;
+
+  return 0;
+}
+
+/* Nearest rank percentile of the run times in the history (milliseconds):
+ * returns -1 if fewer than EXIT_STATUS_HISTORY_MIN runs were recorded. */
+int64_t exit_status_percentile(const exit_status_t *es, unsigned int p) {
+  uint32_t history[EXIT_STATUS_HISTORY];
+  size_t n;
+  size_t rank;
+
+  n = es->map->runs < EXIT_STATUS_HISTORY ? es->map->runs
+                                          : EXIT_STATUS_HISTORY;
+  if (n < EXIT_STATUS_HISTORY_MIN)
+    return -1;
+
+  (void)memcpy(history, es->map->history, n * sizeof(history[0]));
+  qsort(history, n, sizeof(history[0]), cmp_history);
+
+  rank = (p * n + 99) / 100;
+
+  return history[rank == 0 ? 0 : rank - 1];
+}
+
+static int cmp_history(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+static int sync_dir(const char *file) {
+  char *path;
+  int fd;
+  int rv;
+
+  path = strdup(file);
+  if (path == NULL)
+    return -1;
+
+  fd = open(dirname(path), O_RDONLY | O_CLOEXEC);
+  free(path);
+  if (fd < 0)
+    return -1;
+
+  rv = fsync(fd);
+  (void)close(fd);
+
+  return rv;
+}
+
+/* The record is written through a shared mapping: a store to a page
+ * without allocated blocks raises SIGBUS if the file system is full.
+ * The blocks are allocated before the file is mapped. */
+static int alloc_exit_status(int fd, off_t size, off_t len) {
+  char zero[512] = {0};
+  off_t off;
+  ssize_t n;
+#ifndef __APPLE__
+  int rv;
+
+  rv = posix_fallocate(fd, 0, len);
+  if (rv == 0)
+    return 0;
+
+  if (rv != EINVAL && rv != EOPNOTSUPP) {
+    errno = rv;
+    return -1;
+  }
+#endif
+
+  /* not supported by the file system: extend the file with zeros */
+  for (off = size; off < len; off += n) {
+    n = pwrite(fd, zero,
+               len - off < (off_t)sizeof(zero) ? (size_t)(len - off)
+                                               : sizeof(zero),
+               off);
+    if (n < 0) {
+      if (errno != EINTR)
+        return -1;
+      n = 0;
+    }
+  }
+
+  return 0;
+}
+
+static int map_exit_status(exit_status_t *es) {
+  struct stat st;
+  void *p;
+
+  if (fstat(es->fd, &st) < 0)
+    return -1;
+
+  if (alloc_exit_status(es->fd, st.st_size, sizeof(exit_status_file_t)) < 0)
+    return -1;
+
+  p = mmap(NULL, sizeof(exit_status_file_t), PROT_READ | PROT_WRITE,
+           MAP_SHARED, es->fd, 0);
+  if (p == MAP_FAILED)
+    return -1;
+
+  es->map = p;
+
+  if (es->map->magic != EXIT_STATUS_MAGIC ||
+      es->map->version != EXIT_STATUS_VERSION) {
+    (void)memset((char *)es->map + 1, 0, sizeof(exit_status_file_t) - 1);
+    es->map->magic = EXIT_STATUS_MAGIC;
+    es->map->version = EXIT_STATUS_VERSION;
+  }
+
+  return 0;
+}
@@ -0,0 +1,112 @@
+/* Copyright (c) 2019-2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <stdint.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <time.h>
+
+/* The state of a job is kept in the lock file. The first byte is the
+ * exit status of the last run (the format used by earlier versions of
+ * runcron). The byte is followed by a versioned record of the last run.
+ *
+ * The record is double buffered: a new record is written to the unused
+ * slot before the generation counter is incremented. */
+
+#define EXIT_STATUS_MAGIC 0x72637374 /* "rcst" */
+#define EXIT_STATUS_VERSION 1
+
+/* number of run times kept in the history */
+#define EXIT_STATUS_HISTORY 64
+/* minimum number of run times for exit_status_percentile */
+#define EXIT_STATUS_HISTORY_MIN 10
+
+/* --state-sync: durability of updates to the state file */
+enum {
+  EXIT_STATUS_SYNC_NONE,
+  /* sync the exit status when the task exits */
+  EXIT_STATUS_SYNC_DATA,
+  /* sync the file and directory on creation and every update */
+  EXIT_STATUS_SYNC_FULL,
+};
+
+typedef struct {
+  /* time the task was last started and exited (seconds since the epoch) */
+  int64_t start;
+  int64_t end;
+  /* exit status of the last run (128 + signal if terminated by a signal) */
+  int32_t status;
+  /* signal terminating the task or 0 */
+  int32_t signal;
+  /* run time (milliseconds) */
+  int64_t wall;
+  /* CPU time (microseconds) */
+  int64_t utime;
+  int64_t stime;
+  /* maximum resident set size (kilobytes) */
+  int64_t maxrss;
+  /* number of consecutive runs exiting non-0 */
+  uint32_t failures;
+  uint32_t pad;
+  /* block input and output operations */
+  int64_t inblock;
+  int64_t oublock;
+  /* voluntary and involuntary context switches */
+  int64_t nvcsw;
+  int64_t nivcsw;
+  /* start latency (microseconds): time from the scheduled run to waking
+   * up, from waking up to fork(2) and from fork(2) to exec(3) */
+  int64_t lag;
+  int64_t fork;
+  int64_t exec;
+  /* time the run was deferred due to host pressure (seconds) */
+  uint32_t deferred;
+  uint32_t reserved;
+} exit_status_record_t;
+
+typedef struct {
+  uint8_t status;
+  uint8_t pad[3];
+  uint32_t magic;
+  uint32_t version;
+  uint32_t generation;
+  exit_status_record_t slot[2];
+  /* run time of the last successful runs (milliseconds): a ring buffer
+   * indexed by the number of runs recorded. The history is appended to
+   * the state file: a file created by an earlier version is extended
+   * with an empty history. */
+  uint32_t runs;
+  uint32_t history[EXIT_STATUS_HISTORY];
+} exit_status_file_t;
+
+typedef struct {
+  int fd;
+  int sync;
+  exit_status_file_t *map;
+} exit_status_t;
+
+int exit_status_sync_mode(const char *mode);
+int open_exit_status(char *file, exit_status_t *es, int sync, int *status);
+int sync_exit_status(exit_status_t *es, int level);
+int read_exit_status(exit_status_t *es, exit_status_record_t *rec);
+int write_exit_status(exit_status_t *es, int status);
+int write_exit_record(exit_status_t *es, const exit_status_record_t *rec);
+void exit_status_start(exit_status_t *es, time_t start);
+void exit_status_latency(exit_status_t *es, int64_t lag, int64_t fork,
+                         int64_t exec);
+void exit_status_deferred(exit_status_t *es, uint32_t deferred);
+void exit_status_end(exit_status_t *es, time_t end, int64_t wall, int status,
+                     const struct rusage *ru);
+int exit_status_env(const exit_status_record_t *rec);
+int64_t exit_status_percentile(const exit_status_t *es, unsigned int p);
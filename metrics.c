@@ -0,0 +1,212 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "runcron.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "exit_status.h"
+#include "metrics.h"
+
+#ifndef HOST_NAME_MAX
+#define HOST_NAME_MAX 255
+#endif
+
+static int metrics_label(const char *s);
+static void metrics_append(char *buf, size_t size, size_t *len,
+                           const char *fmt, ...);
+static void metrics_gauge(char *buf, size_t size, size_t *len,
+                          const char *name, const char *help,
+                          const char *value);
+static int metrics_write(const char *buf, size_t len);
+
+static char file[PATH_MAX];
+static char tmp[PATH_MAX];
+/* escaped tag label value */
+static char label[HOST_NAME_MAX * 2 + 1];
+
+static const char *const phases[] = {"sleep", "retry", "run", NULL};
+
+/* The tag defaults to the hostname. */
+int metrics_open(const char *path, const char *tag) {
+  char name[HOST_NAME_MAX + 1] = {0};
+  int n;
+
+  if (tag == NULL) {
+    if (gethostname(name, sizeof(name) - 1) < 0)
+      return -1;
+    tag = name;
+  }
+
+  n = snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  if (n < 0 || (size_t)n >= sizeof(tmp)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  if (metrics_label(tag) < 0)
+    return -1;
+
+  (void)snprintf(file, sizeof(file), "%s", path);
+
+  return 0;
+}
+
+/* Rewrite the metrics file: t is the scheduled time of the next or
+ * current run, rec is the record of the previous run. The metrics are
+ * formatted into a fixed size buffer and written using a single write. */
+int metrics_update(const char *phase, time_t t, int status,
+                   const exit_status_record_t *rec) {
+  char buf[4096];
+  char value[32];
+  size_t len = 0;
+  int i;
+
+  if (file[0] == '\0')
+    return 0;
+
+  metrics_append(buf, sizeof(buf), &len,
+                 "# HELP runcron_phase Phase of the job.\n"
+                 "# TYPE runcron_phase gauge\n");
+  for (i = 0; phases[i] != NULL; i++)
+    metrics_append(buf, sizeof(buf), &len,
+                   "runcron_phase{tag=\"%s\",phase=\"%s\"} %d\n", label,
+                   phases[i], strcmp(phase, phases[i]) == 0);
+
+  (void)snprintf(value, sizeof(value), "%lld", (long long)t);
+  metrics_gauge(buf, sizeof(buf), &len, "runcron_next_run_timestamp_seconds",
+                "Scheduled time of the next or current run.", value);
+
+  (void)snprintf(value, sizeof(value), "%d", status);
+  metrics_gauge(buf, sizeof(buf), &len, "runcron_last_exit_status",
+                "Exit status of the last run.", value);
+
+  (void)snprintf(value, sizeof(value), "%lld", (long long)rec->end);
+  metrics_gauge(buf, sizeof(buf), &len, "runcron_last_run_timestamp_seconds",
+                "Time the last run exited.", value);
+
+  (void)snprintf(value, sizeof(value), "%.3f", (double)rec->wall / 1e3);
+  metrics_gauge(buf, sizeof(buf), &len, "runcron_last_run_duration_seconds",
+                "Run time of the last run.", value);
+
+  (void)snprintf(value, sizeof(value), "%u", rec->failures);
+  metrics_gauge(buf, sizeof(buf), &len, "runcron_consecutive_failures",
+                "Number of consecutive runs exiting non-0.", value);
+
+  (void)snprintf(value, sizeof(value), "%.6f", (double)rec->lag / 1e6);
+  metrics_gauge(buf, sizeof(buf), &len, "runcron_last_schedule_lag_seconds",
+                "Time from the scheduled time to the start of the last run.",
+                value);
+
+  (void)snprintf(value, sizeof(value), "%.6f", (double)rec->utime / 1e6);
+  metrics_gauge(buf, sizeof(buf), &len, "runcron_last_cpu_user_seconds",
+                "User CPU time of the last run.", value);
+
+  (void)snprintf(value, sizeof(value), "%.6f", (double)rec->stime / 1e6);
+  metrics_gauge(buf, sizeof(buf), &len, "runcron_last_cpu_system_seconds",
+                "System CPU time of the last run.", value);
+
+  (void)snprintf(value, sizeof(value), "%lld", (long long)rec->maxrss * 1024);
+  metrics_gauge(buf, sizeof(buf), &len, "runcron_last_max_rss_bytes",
+                "Maximum resident set size of the last run.", value);
+
+  if (len >= sizeof(buf)) {
+    errno = ENOBUFS;
+    return -1;
+  }
+
+  return metrics_write(buf, len);
+}
+
+/* Append to the buffer. On overflow, len is set to the size of the
+ * buffer. */
+static void metrics_append(char *buf, size_t size, size_t *len,
+                           const char *fmt, ...) {
+  va_list ap;
+  int n;
+
+  if (*len >= size)
+    return;
+
+  va_start(ap, fmt);
+  n = vsnprintf(buf + *len, size - *len, fmt, ap);
+  va_end(ap);
+
+  *len = (n < 0 || (size_t)n >= size - *len) ? size : *len + (size_t)n;
+}
+
+static void metrics_gauge(char *buf, size_t size, size_t *len,
+                          const char *name, const char *help,
+                          const char *value) {
+  metrics_append(buf, size, len,
+                 "# HELP %s %s\n# TYPE %s gauge\n%s{tag=\"%s\"} %s\n", name,
+                 help, name, name, label, value);
+}
+
+/* Escape the tag for use as a label value. */
+static int metrics_label(const char *s) {
+  size_t len = 0;
+
+  for (; *s != '\0'; s++) {
+    if (len + 2 >= sizeof(label)) {
+      errno = ENAMETOOLONG;
+      return -1;
+    }
+
+    switch (*s) {
+    case '\\':
+    case '"':
+      label[len++] = '\\';
+      label[len++] = *s;
+      break;
+    case '\n':
+      label[len++] = '\\';
+      label[len++] = 'n';
+      break;
+    default:
+      label[len++] = *s;
+      break;
+    }
+  }
+
+  label[len] = '\0';
+
+  return 0;
+}
+
+static int metrics_write(const char *buf, size_t len) {
+  ssize_t n;
+  int fd;
+
+  fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return -1;
+
+  n = write(fd, buf, len);
+  if (n >= 0 && n != (ssize_t)len)
+    errno = EIO;
+
+  if (close(fd) < 0 || n != (ssize_t)len) {
+    (void)unlink(tmp);
+    return -1;
+  }
+
+  return rename(tmp, file);
+}
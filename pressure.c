@@ -0,0 +1,136 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "pressure.h"
+
+static int pressure_parse(const char *s, size_t len);
+static int pressure_avg10(int fd, double *avg10);
+
+static const char *const resources[] = {"cpu", "memory", "io", NULL};
+
+static struct {
+  int fd;
+  double threshold;
+} pressure[3] = {{-1, 0}, {-1, 0}, {-1, 0}};
+
+/* comma separated list of <resource>:<percent>: cpu:50,io:20 */
+int pressure_open(const char *spec) {
+  const char *p = spec;
+  const char *sep;
+  size_t len;
+
+  for (;;) {
+    sep = strchr(p, ',');
+    len = sep == NULL ? strlen(p) : (size_t)(sep - p);
+
+    if (pressure_parse(p, len) < 0)
+      return -1;
+
+    if (sep == NULL)
+      break;
+
+    p = sep + 1;
+  }
+
+  return 0;
+}
+
+/* Returns 1 if the pressure of any resource exceeds the threshold. */
+int pressure_exceeded(void) {
+  double avg10;
+  int i;
+
+  for (i = 0; resources[i] != NULL; i++) {
+    if (pressure[i].fd < 0)
+      continue;
+
+    if (pressure_avg10(pressure[i].fd, &avg10) < 0)
+      return -1;
+
+    if (avg10 > pressure[i].threshold)
+      return 1;
+  }
+
+  return 0;
+}
+
+static int pressure_parse(const char *s, size_t len) {
+  char path[32];
+  const char *sep;
+  char *end;
+  double threshold;
+  int i;
+
+  sep = memchr(s, ':', len);
+  if (sep == NULL)
+    goto ERR;
+
+  errno = 0;
+  threshold = strtod(sep + 1, &end);
+  if (errno != 0 || end != s + len || end == sep + 1 ||
+      !(threshold >= 0 && threshold <= 100))
+    goto ERR;
+
+  for (i = 0; resources[i] != NULL; i++) {
+    if (strlen(resources[i]) != (size_t)(sep - s) ||
+        strncmp(s, resources[i], (size_t)(sep - s)) != 0)
+      continue;
+
+    if (pressure[i].fd < 0) {
+      (void)snprintf(path, sizeof(path), "/proc/pressure/%s", resources[i]);
+      pressure[i].fd = open(path, O_RDONLY | O_CLOEXEC);
+      if (pressure[i].fd < 0)
+        return -1;
+    }
+
+    pressure[i].threshold = threshold;
+    return 0;
+  }
+
+ERR:
+  errno = EINVAL;
+  return -1;
+}
+
+/* some avg10=0.00 avg60=0.00 avg300=0.00 total=0 */
+static int pressure_avg10(int fd, double *avg10) {
+  char buf[256];
+  char *p;
+  ssize_t n;
+
+  if (lseek(fd, 0, SEEK_SET) < 0)
+    return -1;
+
+  n = read(fd, buf, sizeof(buf) - 1);
+  if (n < 0)
+    return -1;
+
+  buf[n] = '\0';
+
+  p = strstr(buf, "some avg10=");
+  if (p == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  *avg10 = strtod(p + strlen("some avg10="), NULL);
+  return 0;
+}
@@ -0,0 +1,241 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+#include "priority.h"
+
+#ifndef HAVE_STRTONUM
+#include "strtonum.h"
+#endif
+
+/* linux/ioprio.h */
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_WHO_PROCESS 1
+
+enum {
+  PRIORITY_NICE = 1 << 0,
+  PRIORITY_SCHED = 1 << 1,
+  PRIORITY_IOPRIO = 1 << 2,
+  PRIORITY_AFFINITY = 1 << 3,
+};
+
+static int set;
+static int nice_value;
+
+#ifdef __linux__
+static int policy;
+static int ioprio;
+static cpu_set_t cpuset;
+
+static const char *const policies[] = {"other", "batch", "idle", NULL};
+static const int policy_value[] = {SCHED_OTHER, SCHED_BATCH, SCHED_IDLE};
+
+/* I/O scheduling classes: the index is the class */
+static const char *const classes[] = {"none", "realtime", "best-effort",
+                                      "idle", NULL};
+#endif
+
+int priority_nice(const char *s) {
+  const char *errstr = NULL;
+
+  nice_value = strtonum(s, -20, 19, &errstr);
+  if (errstr != NULL)
+    return -1;
+
+  set |= PRIORITY_NICE;
+  return 0;
+}
+
+/* other, batch or idle */
+int priority_sched(const char *s) {
+#ifdef __linux__
+  int i;
+
+  for (i = 0; policies[i] != NULL; i++) {
+    if (strcmp(s, policies[i]) == 0) {
+      policy = policy_value[i];
+      set |= PRIORITY_SCHED;
+      return 0;
+    }
+  }
+
+  errno = EINVAL;
+  return -1;
+#else
+  errno = ENOTSUP;
+  return -1;
+#endif
+}
+
+/* <class>[:<level>]: realtime, best-effort or idle with a level from 0
+ * (highest) to 7 (default: 4) */
+int priority_ioprio(const char *s) {
+#ifdef __linux__
+  const char *errstr = NULL;
+  const char *level;
+  size_t len;
+  int n = 4;
+  int i;
+
+  level = strchr(s, ':');
+  len = level == NULL ? strlen(s) : (size_t)(level - s);
+
+  if (level != NULL) {
+    n = strtonum(level + 1, 0, 7, &errstr);
+    if (errstr != NULL)
+      return -1;
+  }
+
+  for (i = 1; classes[i] != NULL; i++) {
+    if (strlen(classes[i]) == len && strncmp(s, classes[i], len) == 0) {
+      ioprio = (i << IOPRIO_CLASS_SHIFT) | (i == 3 ? 0 : n);
+      set |= PRIORITY_IOPRIO;
+      return 0;
+    }
+  }
+
+  errno = EINVAL;
+  return -1;
+#else
+  errno = ENOTSUP;
+  return -1;
+#endif
+}
+
+/* list of CPUs and ranges: 0,2-3 */
+int priority_affinity(const char *s) {
+#ifdef __linux__
+  const char *p = s;
+  char *end;
+  long lo;
+  long hi;
+
+  CPU_ZERO(&cpuset);
+
+  for (;;) {
+    errno = 0;
+    lo = strtol(p, &end, 10);
+    if (errno != 0 || end == p || lo < 0 || lo >= CPU_SETSIZE)
+      goto ERR;
+
+    hi = lo;
+    p = end;
+
+    if (*p == '-') {
+      p++;
+      hi = strtol(p, &end, 10);
+      if (errno != 0 || end == p || hi < lo || hi >= CPU_SETSIZE)
+        goto ERR;
+      p = end;
+    }
+
+    for (; lo <= hi; lo++)
+      CPU_SET(lo, &cpuset);
+
+    if (*p == '\0')
+      break;
+
+    if (*p++ != ',')
+      goto ERR;
+  }
+
+  set |= PRIORITY_AFFINITY;
+  return 0;
+
+ERR:
+  errno = EINVAL;
+  return -1;
+#else
+  errno = ENOTSUP;
+  return -1;
+#endif
+}
+
+/* Apply the settings in a subprocess: fails if the settings are not
+ * permitted (for example, lowering the nice value or the realtime I/O
+ * class requires privileges) or the CPUs are not available. */
+int priority_check(void) {
+  int status;
+  pid_t pid;
+
+  if (set == 0)
+    return 0;
+
+  pid = fork();
+  switch (pid) {
+  case -1:
+    return -1;
+  case 0:
+    _exit(priority_apply() < 0 ? errno : 0);
+  default:
+    break;
+  }
+
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR)
+      return -1;
+  }
+
+  if (!WIFEXITED(status)) {
+    errno = ECHILD;
+    return -1;
+  }
+
+  if (WEXITSTATUS(status) != 0) {
+    errno = WEXITSTATUS(status);
+    return -1;
+  }
+
+  return 0;
+}
+
+int priority_apply(void) {
+  if ((set & PRIORITY_NICE) && setpriority(PRIO_PROCESS, 0, nice_value) < 0)
+    return -1;
+
+#ifdef __linux__
+  if (set & PRIORITY_SCHED) {
+    struct sched_param param = {0};
+
+    if (sched_setscheduler(0, policy, &param) < 0)
+      return -1;
+  }
+
+  if ((set & PRIORITY_IOPRIO) &&
+      syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, ioprio) < 0)
+    return -1;
+
+  if ((set & PRIORITY_AFFINITY) &&
+      sched_setaffinity(0, sizeof(cpuset), &cpuset) < 0)
+    return -1;
+#endif
+
+  return 0;
+}
@@ -0,0 +1,36 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* USDT probes for tracing using bpftrace(8), perf(1) or dtrace(1). The
+ * probes are compiled in if sys/sdt.h is available (see the USDT
+ * Makefile variable): a disabled probe is a nop instruction.
+ *
+ * Provider: runcron */
+
+#ifdef RUNCRON_USDT
+#include <sys/sdt.h>
+
+#define PROBE0(name) DTRACE_PROBE(runcron, name)
+#define PROBE1(name, a1) DTRACE_PROBE1(runcron, name, a1)
+#define PROBE2(name, a1, a2) DTRACE_PROBE2(runcron, name, a1, a2)
+#define PROBE3(name, a1, a2, a3) DTRACE_PROBE3(runcron, name, a1, a2, a3)
+#else
+#define PROBE0(name)                                                           \
+  do {                                                                         \
+  } while (0)
+#define PROBE1(name, a1) PROBE0(name)
+#define PROBE2(name, a1, a2) PROBE0(name)
+#define PROBE3(name, a1, a2, a3) PROBE0(name)
+#endif
@@ -0,0 +1,55 @@
+/* Copyright (c) 2019-2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "fnv1a.h"
+#include "randinit.h"
+
+static uint32_t seed_from_time(void);
+
+static uint32_t seed_from_time(void) {
+  struct timeval tv = {0};
+
+  (void)gettimeofday(&tv, NULL);
+
+  return getpid() ^ tv.tv_sec ^ tv.tv_usec;
+}
+
+int randinit(char *tag) {
+  uint32_t seed;
+  char name[MAXHOSTNAMELEN] = {0};
+  size_t len;
+
+  if (tag == NULL) {
+    if (gethostname(name, sizeof(name) - 1) < 0)
+      return -1;
+    tag = name;
+  }
+
+  len = strlen(tag);
+  seed = len == 0 ? seed_from_time() : fnv1a((uint8_t *)tag, len);
+
+#if defined(__OpenBSD__)
+  srandom_deterministic(seed);
+#else
+  srandom(seed);
+#endif
+  return 0;
+}
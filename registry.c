@@ -0,0 +1,280 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "runcron.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "registry.h"
+
+/* attempts to read a record being written: a record is skipped if the
+ * writer was stopped or exited while writing */
+#define REGISTRY_RETRIES 1000
+
+static int registry_init(int fd);
+static int registry_valid(int fd, registry_header_t *hdr);
+static int registry_lock(int fd, off_t off, int cmd, int type);
+static void registry_begin(void);
+static void registry_end(void);
+
+static registry_record_t *self;
+static pid_t owner;
+/* descriptor holding the lock on the record */
+static int regfd = -1;
+
+/* Open or create the registry and claim an unused record. A record is
+ * owned by the process holding a write lock on the record: the lock is
+ * released when the process exits. */
+int registry_open(const char *path, const char *name) {
+  registry_header_t hdr;
+  struct stat st;
+  char *p;
+  uint32_t i;
+  int fd;
+
+  fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return -1;
+
+  if (registry_init(fd) < 0 || registry_valid(fd, &hdr) < 0)
+    goto ERR;
+
+  if (fstat(fd, &st) < 0)
+    goto ERR;
+
+  p = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+           0);
+  if (p == MAP_FAILED)
+    goto ERR;
+
+  for (i = 0; i < hdr.n; i++) {
+    off_t off = sizeof(registry_header_t) + i * sizeof(registry_record_t);
+
+    if (registry_lock(fd, off, F_SETLK, F_WRLCK) == 0) {
+      self = (registry_record_t *)(p + off);
+      break;
+    }
+
+    if (errno != EACCES && errno != EAGAIN)
+      goto ERR;
+  }
+
+  if (self == NULL) {
+    errno = ENOSPC;
+    goto ERR;
+  }
+
+  /* The descriptor is not closed: closing any descriptor for the file
+   * releases the lock. */
+  regfd = fd;
+  owner = getpid();
+
+  /* A record left by a process that exited while writing has an odd
+   * sequence number: the sequence number is made odd rather than
+   * incremented so the record is even when the write completes. */
+  __atomic_store_n(&self->seq, self->seq | 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  (void)memset((char *)self + sizeof(self->seq), 0,
+               sizeof(registry_record_t) - sizeof(self->seq));
+  self->pid = owner;
+  (void)snprintf(self->name, sizeof(self->name), "%s", name);
+  registry_end();
+
+  return 0;
+
+ERR:
+  (void)close(fd);
+  return -1;
+}
+
+/* Update the record: only writes to memory. */
+void registry_update(int phase, time_t t, unsigned int timeout, int status,
+                     pid_t task) {
+  if (self == NULL)
+    return;
+
+  registry_begin();
+  self->pid = owner;
+  self->task = task;
+  self->status = status;
+  self->time = t;
+  self->timeout = timeout;
+  self->phase = phase;
+  registry_end();
+}
+
+/* --exec: the record is owned by the task: the registry descriptor is
+ * inherited across exec(3) and the lock is held until the task exits. */
+int registry_exec(void) {
+  if (regfd < 0)
+    return 0;
+
+  return fcntl(regfd, F_SETFD, 0);
+}
+
+/* Copy the records owned by running processes. Returns the number of
+ * records. */
+ssize_t registry_read(const char *path, registry_record_t **rec) {
+  registry_header_t hdr;
+  registry_record_t *r;
+  struct stat st;
+  char *p;
+  ssize_t n = 0;
+  uint32_t i;
+  int fd;
+
+  fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+
+  if (registry_valid(fd, &hdr) < 0 || fstat(fd, &st) < 0)
+    goto ERR;
+
+  *rec = calloc(hdr.n, sizeof(registry_record_t));
+  if (*rec == NULL)
+    goto ERR;
+
+  p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED)
+    goto ERR;
+
+  r = (registry_record_t *)(p + sizeof(registry_header_t));
+
+  for (i = 0; i < hdr.n; i++) {
+    registry_record_t *e = &(*rec)[n];
+    uint32_t seq;
+    int retry;
+
+    if (__atomic_load_n(&r[i].pid, __ATOMIC_RELAXED) == 0)
+      continue;
+
+    for (retry = 0; retry < REGISTRY_RETRIES; retry++) {
+      seq = __atomic_load_n(&r[i].seq, __ATOMIC_ACQUIRE);
+      (void)memcpy(e, &r[i], sizeof(registry_record_t));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (!(seq & 1) && seq == __atomic_load_n(&r[i].seq, __ATOMIC_RELAXED))
+        break;
+    }
+
+    if (retry == REGISTRY_RETRIES)
+      continue;
+
+    /* the record was left by a process that has exited */
+    if (registry_lock(fd,
+                      sizeof(registry_header_t) +
+                          i * sizeof(registry_record_t),
+                      F_GETLK, F_RDLCK) < 0 ||
+        e->pid == 0)
+      continue;
+
+    e->name[sizeof(e->name) - 1] = '\0';
+    n++;
+  }
+
+  (void)munmap(p, (size_t)st.st_size);
+  (void)close(fd);
+
+  return n;
+
+ERR:
+  (void)close(fd);
+  return -1;
+}
+
+/* Initialize an empty registry. The header is locked to serialize
+ * creation. */
+static int registry_init(int fd) {
+  registry_header_t hdr = {0};
+  struct stat st;
+  int rv = -1;
+
+  if (registry_lock(fd, 0, F_SETLKW, F_WRLCK) < 0)
+    return -1;
+
+  if (fstat(fd, &st) < 0)
+    goto DONE;
+
+  if (st.st_size == 0) {
+    (void)memcpy(hdr.magic, REGISTRY_MAGIC, sizeof(REGISTRY_MAGIC));
+    hdr.version = REGISTRY_VERSION;
+    hdr.size = sizeof(registry_record_t);
+    hdr.n = REGISTRY_RECORDS;
+
+    if (ftruncate(fd, sizeof(hdr) +
+                          REGISTRY_RECORDS * sizeof(registry_record_t)) < 0 ||
+        pwrite(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr))
+      goto DONE;
+  }
+
+  rv = 0;
+
+DONE:
+  (void)registry_lock(fd, 0, F_SETLK, F_UNLCK);
+  return rv;
+}
+
+static int registry_valid(int fd, registry_header_t *hdr) {
+  struct stat st;
+
+  if (fstat(fd, &st) < 0)
+    return -1;
+
+  if ((size_t)st.st_size < sizeof(*hdr) ||
+      pread(fd, hdr, sizeof(*hdr), 0) != sizeof(*hdr) ||
+      memcmp(hdr->magic, REGISTRY_MAGIC, sizeof(REGISTRY_MAGIC)) != 0 ||
+      hdr->version != REGISTRY_VERSION ||
+      hdr->size != sizeof(registry_record_t) ||
+      (size_t)st.st_size <
+          sizeof(*hdr) + (size_t)hdr->n * sizeof(registry_record_t)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  return 0;
+}
+
+/* Lock the header (offset 0) or a record. F_GETLK: returns 0 if the
+ * region is locked by another process. */
+static int registry_lock(int fd, off_t off, int cmd, int type) {
+  struct flock fl = {0};
+
+  fl.l_type = type;
+  fl.l_whence = SEEK_SET;
+  fl.l_start = off;
+  fl.l_len = off == 0 ? sizeof(registry_header_t) : sizeof(registry_record_t);
+
+  if (fcntl(fd, cmd, &fl) < 0)
+    return -1;
+
+  if (cmd == F_GETLK && fl.l_type == F_UNLCK)
+    return -1;
+
+  return 0;
+}
+
+static void registry_begin(void) {
+  __atomic_store_n(&self->seq, self->seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void registry_end(void) {
+  __atomic_store_n(&self->seq, self->seq + 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,61 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+/* Status registry: a file shared by runcron processes. Each process
+ * publishes a fixed size record. Records are updated using a sequence
+ * lock: readers retry if the record was modified while being read. */
+
+#define REGISTRY_MAGIC "runcron"
+#define REGISTRY_VERSION 1
+#define REGISTRY_RECORDS 4096
+
+enum {
+  REGISTRY_SLEEP = 1,
+  REGISTRY_RETRY,
+  REGISTRY_RUN,
+};
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t size;
+  uint32_t n;
+  char pad[44];
+} registry_header_t;
+
+typedef struct {
+  /* odd while the record is being written */
+  uint32_t seq;
+  /* runcron process, 0 if the record is unused */
+  int32_t pid;
+  /* task process */
+  int32_t task;
+  /* last exit status */
+  int32_t status;
+  /* sleep: time of the next run, run: time the task started */
+  int64_t time;
+  uint32_t timeout;
+  uint32_t phase;
+  char name[96];
+} registry_record_t;
+
+int registry_open(const char *path, const char *name);
+void registry_update(int phase, time_t t, unsigned int timeout, int status,
+                     pid_t task);
+int registry_exec(void);
+ssize_t registry_read(const char *path, registry_record_t **rec);
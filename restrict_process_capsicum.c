@@ -61,7 +61,7 @@ int restrict_process(void) {
   return cap_enter();
 }
 
-int restrict_process_wait(int fdp) {
+int restrict_process_wait(int fdp, int sockfd) {
   struct rlimit rl = {0};
   cap_rights_t policy_read;
   cap_rights_t policy_write;
@@ -89,6 +89,16 @@ int restrict_process_wait(int fdp) {
   if (cap_rights_limit(fdp, &policy_rw) < 0)
     return -1;
 
+  if (sockfd > -1) {
+    cap_rights_t policy_sock;
+
+    /* accepted connections inherit the rights of the listening socket */
+    (void)cap_rights_init(&policy_sock, CAP_ACCEPT, CAP_READ, CAP_WRITE,
+                          CAP_EVENT);
+    if (cap_rights_limit(sockfd, &policy_sock) < 0)
+      return -1;
+  }
+
   return 0;
 }
 #endif
@@ -22,8 +22,9 @@ int restrict_process_init(void) { return 0; }
 
 int restrict_process(void) { return 0; }
 
-int restrict_process_wait(int fdp) {
+int restrict_process_wait(int fdp, int sockfd) {
   (void)fdp;
+  (void)sockfd;
   return 0;
 }
 #endif
@@ -42,8 +42,8 @@ int restrict_process_init(void) {
 
 int restrict_process(void) { return pledge("stdio", NULL); }
 
-int restrict_process_wait(int fdp) {
+int restrict_process_wait(int fdp, int sockfd) {
   (void)fdp;
-  return pledge("stdio proc", NULL);
+  return pledge(sockfd < 0 ? "stdio proc" : "stdio proc unix", NULL);
 }
 #endif
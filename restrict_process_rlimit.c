@@ -16,6 +16,7 @@
 #ifdef RESTRICT_PROCESS_rlimit
 #include <sys/resource.h>
 #include <time.h>
+#include <unistd.h>
 
 int disable_setuid_subprocess(void) { return 0; }
 
@@ -35,14 +36,31 @@ int restrict_process(void) {
   return setrlimit(RLIMIT_NOFILE, &rl_zero);
 }
 
-int restrict_process_wait(int fdp) {
+int restrict_process_wait(int fdp, int sockfd) {
   struct rlimit rl_zero = {0};
+  struct rlimit rl_nofile = {0};
+  int fd;
 
   (void)fdp;
 
   if (setrlimit(RLIMIT_NPROC, &rl_zero) < 0)
     return -1;
 
-  return setrlimit(RLIMIT_NOFILE, &rl_zero);
+  if (sockfd < 0)
+    return setrlimit(RLIMIT_NOFILE, &rl_zero);
+
+  /* control socket: allow a single connection using the lowest available
+   * descriptor */
+  fd = dup(sockfd);
+  if (fd < 0)
+    return -1;
+
+  if (close(fd) < 0)
+    return -1;
+
+  rl_nofile.rlim_cur = (rlim_t)fd + 1;
+  rl_nofile.rlim_max = (rlim_t)fd + 1;
+
+  return setrlimit(RLIMIT_NOFILE, &rl_nofile);
 }
 #endif
@@ -145,7 +145,7 @@ int restrict_process(void) {
   return prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog);
 }
 
-int restrict_process_wait(int fdp) {
+int restrict_process_wait(int fdp, int sockfd) {
   struct sock_filter filter[] = {
       /* Ensure the syscall arch convention is as expected. */
       BPF_STMT(BPF_LD + BPF_W + BPF_ABS, offsetof(struct seccomp_data, arch)),
@@ -207,6 +207,56 @@ int restrict_process_wait(int fdp) {
       SC_ALLOW(kill),
 #endif
 
+  /* sync_exit_status */
+#ifdef __NR_msync
+      SC_ALLOW(msync),
+#endif
+
+  /* supervise_epoll */
+#ifdef __NR_read
+      SC_ALLOW(read),
+#endif
+#ifdef __NR_epoll_wait
+      SC_ALLOW(epoll_wait),
+#endif
+#ifdef __NR_epoll_pwait
+      SC_ALLOW(epoll_pwait),
+#endif
+#ifdef __NR_timerfd_settime
+      SC_ALLOW(timerfd_settime),
+#endif
+#ifdef __NR_timerfd_gettime
+      SC_ALLOW(timerfd_gettime),
+#endif
+#ifdef __NR_clock_gettime
+      SC_ALLOW(clock_gettime),
+#endif
+
+  /* supervise_epoll: control socket */
+#ifdef __NR_accept4
+      SC_ALLOW(accept4),
+#endif
+#ifdef __NR_epoll_ctl
+      SC_ALLOW(epoll_ctl),
+#endif
+#ifdef __NR_sendto
+      SC_ALLOW(sendto),
+#endif
+#ifdef __NR_close
+      SC_ALLOW(close),
+#endif
+
+  /* supervise_epoll: --heartbeat-file */
+#ifdef __NR_fstat
+      SC_ALLOW(fstat),
+#endif
+#ifdef __NR_fstat64
+      SC_ALLOW(fstat64),
+#endif
+#ifdef __NR_newfstatat
+      SC_ALLOW(newfstatat),
+#endif
+
       /* Default deny */
       BPF_STMT(BPF_RET + BPF_K, SECCOMP_FILTER_FAIL)};
 
@@ -216,6 +266,7 @@ int restrict_process_wait(int fdp) {
   };
 
   (void)fdp;
+  (void)sockfd;
 
   return prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &prog);
 }
@@ -30,10 +30,24 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "cgroup.h"
 #include "cronevent.h"
-#include "fnv1a.h"
+#include "crontab.h"
+#include "events.h"
+#include "exit_status.h"
+#include "metrics.h"
+#include "pressure.h"
+#include "priority.h"
+#include "probe.h"
+#include "randinit.h"
+#include "registry.h"
 #include "restrict_process.h"
+#include "set_env.h"
+#include "slots.h"
+#include "subreaper.h"
+#include "supervise.h"
 #include "timestamp.h"
+#include "top.h"
 #include "waitfor.h"
 #ifndef HAVE_STRTONUM
 #include "strtonum.h"
@@ -46,72 +60,137 @@
 #include <sys/procdesc.h>
 #endif
 
-#ifdef HAVE_SETPROCTITLE
-#define RUNCRON_TITLE "(%s %ds) %s"
-#else
-#define RUNCRON_TITLE "runcron: (%s %ds) %s"
-#endif
-
 #define RUNCRON_VERSION "0.19.4"
 
-static int open_exit_status(char *file, int *status);
-static int read_exit_status(int fd, int *status);
-static int write_exit_status(int fd, int status);
-void sleepfor(unsigned int seconds);
-int signal_init(void (*handler)(int, siginfo_t *, void *));
-void sa_handler_sleep(int sig, siginfo_t *info, void *context);
-void sa_handler_wait(int sig, siginfo_t *info, void *context);
-static int set_env(char *key, int val);
+static int record_exit(runcron_t *rp, char *file, int value);
 static void print_argv(int argc, char *argv[]);
-static uint32_t seed_from_time(void);
-static int randinit(char *tag);
+static void print_rusage(const exit_status_record_t *rec);
 static char *join(char **arg, size_t n);
+static int reschedule(runcron_t *rp, char *cronentry, int status,
+                      struct timespec *start, time_t t, time_t *fire,
+                      unsigned int *seconds, unsigned int *timeout);
 static void usage(void);
 
+/* --events-fd: reason for supervise_sleep() returning */
+static const char *const wake_reason[] = {"run", "clock", "skip",
+                                          "postpone"};
+
 static const struct option long_options[] = {
     {"file", required_argument, NULL, 'f'},
+    {"cgroup", required_argument, NULL, OPT_CGROUP},
     {"chdir", required_argument, NULL, 'C'},
+    {"control", required_argument, NULL, OPT_CONTROL},
+    {"crontab", required_argument, NULL, OPT_CRONTAB},
     {"tag", required_argument, NULL, 't'},
     {"timeout", required_argument, NULL, 'T'},
+    {"registry", required_argument, NULL, OPT_REGISTRY},
     {"retry-interval", required_argument, NULL, 'R'},
     {"poll-interval", required_argument, NULL, 'P'},
+    {"pressure", required_argument, NULL, OPT_PRESSURE},
+    {"pressure-max-delay", required_argument, NULL, OPT_PRESSURE_MAX_DELAY},
+    {"pause-on-pressure", no_argument, NULL, OPT_PAUSE_ON_PRESSURE},
+    {"pause-extends-timeout", no_argument, NULL, OPT_PAUSE_EXTENDS_TIMEOUT},
+    {"adaptive-timeout", required_argument, NULL, OPT_ADAPTIVE_TIMEOUT},
+    {"kill-after", required_argument, NULL, OPT_KILL_AFTER},
+    {"heartbeat", required_argument, NULL, OPT_HEARTBEAT},
+    {"heartbeat-file", required_argument, NULL, OPT_HEARTBEAT_FILE},
+    {"heartbeat-output", no_argument, NULL, OPT_HEARTBEAT_OUTPUT},
     {"dryrun", no_argument, NULL, 'n'},
     {"print", no_argument, NULL, 'p'},
     {"signal", required_argument, NULL, 's'},
+    {"slots", required_argument, NULL, OPT_SLOTS},
+    {"subreaper", no_argument, NULL, OPT_SUBREAPER},
+    {"init", no_argument, NULL, OPT_INIT},
+    {"exec", no_argument, NULL, OPT_EXEC},
+    {"record-exit", required_argument, NULL, OPT_RECORD_EXIT},
+    {"sort", required_argument, NULL, OPT_SORT},
+    {"state-sync", required_argument, NULL, OPT_STATE_SYNC},
     {"limit-cpu", required_argument, NULL, OPT_LIMIT_CPU},
     {"limit-as", required_argument, NULL, OPT_LIMIT_AS},
+    {"metrics-file", required_argument, NULL, OPT_METRICS_FILE},
+    {"memory-max", required_argument, NULL, OPT_MEMORY_MAX},
+    {"cpu-max", required_argument, NULL, OPT_CPU_MAX},
+    {"io-max", required_argument, NULL, OPT_IO_MAX},
+    {"nice", required_argument, NULL, OPT_NICE},
+    {"sched", required_argument, NULL, OPT_SCHED},
+    {"ioprio", required_argument, NULL, OPT_IOPRIO},
+    {"cpu-affinity", required_argument, NULL, OPT_CPU_AFFINITY},
     {"timestamp", required_argument, NULL, OPT_TIMESTAMP},
+    {"top", no_argument, NULL, OPT_TOP},
     {"allow-setuid-subprocess", no_argument, NULL, OPT_ALLOW_SETUID_SUBPROCESS},
     {"disable-process-restrictions", no_argument, NULL,
      OPT_DISABLE_PROCESS_RESTRICTIONS},
     {"disable-signal-on-exit", no_argument, NULL, OPT_DISABLE_SIGNAL_ON_EXIT},
+    {"events-fd", required_argument, NULL, OPT_EVENTS_FD},
     {"verbose", no_argument, NULL, 'v'},
     {"version", no_argument, NULL, 'V'},
     {"help", no_argument, NULL, 'h'},
     {NULL, 0, NULL, 0},
 };
 
-static pid_t pid;
-static int fdp = -1;
-static int default_signal = SIGTERM;
-static volatile sig_atomic_t runnow = 0;
-static volatile sig_atomic_t remaining = 0;
-
 int main(int argc, char *argv[]) {
   runcron_t *rp;
   char *file = ".runcron.lock";
   char *cwd = NULL;
   char *cronentry;
   char *tag = NULL;
+  char *crontab = NULL;
+  char *control = NULL;
+  char *registry = NULL;
+  char *metrics = NULL;
+  char *cgroup = NULL;
+  char *memory_max = NULL;
+  char *cpu_max = NULL;
+  char *io_max = NULL;
+  char *slots = NULL;
+  int slot;
+  char *pressure = NULL;
+  unsigned int pressure_max_delay = 300;
+  unsigned int deferred = 0;
+  int deferring = 0;
+  unsigned int heartbeat = 0;
+  char *heartbeat_file = NULL;
+  int heartbeat_mode = SUPERVISE_HEARTBEAT_FD;
+  int hbfd;
+  double factor = 0;
+  pid_t stragglers[16];
+  size_t npids = 0;
+  int nstragglers;
+  int nreaped;
+  int exec_task = 0;
+  int show_top = 0;
+  int exit_record = -1;
+  int64_t p99;
+  char *end;
+  const char *phase;
+  int eventfd = -1;
+  int sort = 0;
   int fd;
+  exit_status_t es;
+  exit_status_record_t last;
+  struct rusage ru = {0};
+  int fdp = -1;
+  int sockfd = -1;
+  pid_t pid;
   int status = 0;
   time_t now;
+  time_t wallclock;
   unsigned int seconds;
-  unsigned int timeout = 0;
-  unsigned int retry_interval = 3600; /* 1 hour */
+  unsigned int timeout;
+  struct timespec start;
+  struct timespec run;
+  struct timespec ts;
+  struct timespec wake;
+  struct timespec forked;
+  struct timespec exec;
+  time_t fire = 0;
+  time_t deadline;
+  int64_t lag;
+  int execfd[2];
+  int error;
+  int rv;
   const char *errstr = NULL;
   int exit_value = 0;
-  int signal_on_exit = 1;
   int allow_setuid_subprocess = 0;
 
   char **oargv = argv + 1;
@@ -137,6 +216,8 @@ int main(int argc, char *argv[]) {
 
   rp->cpu = 10;
   rp->as = 1 * 1024 * 1024;
+  rp->retry_interval = 3600; /* 1 hour */
+  rp->signal = SIGTERM;
 
   tag = getenv("RUNCRON_TAG");
 
@@ -144,6 +225,10 @@ int main(int argc, char *argv[]) {
   if (now == -1)
     err(EXIT_FAILURE, "time");
 
+  /* the schedule is calculated from now (or --timestamp): the time of the
+   * run is relative to the same reading of the clock */
+  wallclock = now;
+
   (void)localtime(&now);
 
   while ((ch = getopt_long(argc, argv, "+C:f:hnpP:R:s:t:T:vV", long_options,
@@ -168,14 +253,14 @@ int main(int argc, char *argv[]) {
     case 'P': /* deprecated: use -R */
     case 'R':
       errno = 0;
-      retry_interval = strtonum(optarg, 0, INT_MAX, &errstr);
+      rp->retry_interval = strtonum(optarg, 0, INT_MAX, &errstr);
       if (errstr != NULL)
         err(2, "strtonum: %s: %s", optarg, errstr);
       break;
 
     case 's':
       errno = 0;
-      default_signal = strtonum(optarg, 0, NSIG, &errstr);
+      rp->signal = strtonum(optarg, 0, NSIG, &errstr);
       if (errstr != NULL)
         err(2, "strtonum: %s: %s", optarg, errstr);
       break;
@@ -186,7 +271,7 @@ int main(int argc, char *argv[]) {
 
     case 'T':
       errno = 0;
-      timeout = strtonum(optarg, -1, UINT32_MAX, &errstr);
+      rp->timeout = strtonum(optarg, -1, UINT32_MAX, &errstr);
       if (errstr != NULL)
         err(2, "strtonum: %s: %s", optarg, errstr);
       break;
@@ -204,6 +289,156 @@ int main(int argc, char *argv[]) {
       allow_setuid_subprocess = 1;
       break;
 
+    case OPT_CONTROL:
+      control = optarg;
+      break;
+
+    case OPT_CRONTAB:
+      crontab = optarg;
+      break;
+
+    case OPT_REGISTRY:
+      registry = optarg;
+      break;
+
+    case OPT_METRICS_FILE:
+      metrics = optarg;
+      break;
+
+    case OPT_CGROUP:
+      cgroup = optarg;
+      break;
+
+    case OPT_MEMORY_MAX:
+      memory_max = optarg;
+      break;
+
+    case OPT_CPU_MAX:
+      cpu_max = optarg;
+      break;
+
+    case OPT_IO_MAX:
+      io_max = optarg;
+      break;
+
+    case OPT_PRESSURE:
+      pressure = optarg;
+      if (pressure_open(pressure) < 0)
+        err(2, "error: pressure: %s", optarg);
+      break;
+
+    case OPT_PRESSURE_MAX_DELAY:
+      errno = 0;
+      pressure_max_delay = strtonum(optarg, 0, UINT32_MAX, &errstr);
+      if (errstr != NULL)
+        err(2, "strtonum: %s: %s", optarg, errstr);
+      break;
+
+    case OPT_PAUSE_ON_PRESSURE:
+      rp->opt |= OPT_PAUSE_ON_PRESSURE;
+      break;
+
+    case OPT_PAUSE_EXTENDS_TIMEOUT:
+      rp->opt |= OPT_PAUSE_EXTENDS_TIMEOUT;
+      break;
+
+    case OPT_ADAPTIVE_TIMEOUT:
+      errno = 0;
+      factor = strtod(optarg, &end);
+      if (errno != 0 || end == optarg || *end != '\0' ||
+          !(factor >= 1 && factor <= 1000))
+        errx(2, "error: invalid timeout factor: %s", optarg);
+      break;
+
+    case OPT_KILL_AFTER:
+      errno = 0;
+      rp->kill_after = strtonum(optarg, 0, INT_MAX, &errstr);
+      if (errstr != NULL)
+        err(2, "strtonum: %s: %s", optarg, errstr);
+      break;
+
+    case OPT_HEARTBEAT:
+      errno = 0;
+      heartbeat = strtonum(optarg, 1, INT_MAX, &errstr);
+      if (errstr != NULL)
+        err(2, "strtonum: %s: %s", optarg, errstr);
+      break;
+
+    case OPT_HEARTBEAT_FILE:
+      heartbeat_file = optarg;
+      heartbeat_mode = SUPERVISE_HEARTBEAT_FILE;
+      break;
+
+    case OPT_HEARTBEAT_OUTPUT:
+      heartbeat_mode = SUPERVISE_HEARTBEAT_OUTPUT;
+      break;
+
+    case OPT_SLOTS:
+      slots = optarg;
+      break;
+
+    case OPT_SUBREAPER:
+      rp->opt |= OPT_SUBREAPER;
+      break;
+
+    case OPT_INIT:
+      rp->opt |= OPT_INIT | OPT_SUBREAPER;
+      break;
+
+    case OPT_EXEC:
+      exec_task = 1;
+      break;
+
+    case OPT_RECORD_EXIT:
+      errno = 0;
+      exit_record = strtonum(optarg, 0, 255, &errstr);
+      if (errstr != NULL)
+        err(2, "strtonum: %s: %s", optarg, errstr);
+      break;
+
+    case OPT_NICE:
+      if (priority_nice(optarg) < 0)
+        err(2, "error: nice: %s", optarg);
+      break;
+
+    case OPT_SCHED:
+      if (priority_sched(optarg) < 0)
+        err(2, "error: sched: %s", optarg);
+      break;
+
+    case OPT_IOPRIO:
+      if (priority_ioprio(optarg) < 0)
+        err(2, "error: ioprio: %s", optarg);
+      break;
+
+    case OPT_CPU_AFFINITY:
+      if (priority_affinity(optarg) < 0)
+        err(2, "error: cpu-affinity: %s", optarg);
+      break;
+
+    case OPT_EVENTS_FD:
+      errno = 0;
+      eventfd = strtonum(optarg, 0, INT_MAX, &errstr);
+      if (errstr != NULL)
+        err(2, "strtonum: %s: %s", optarg, errstr);
+      break;
+
+    case OPT_SORT:
+      sort = top_sort(optarg);
+      if (sort < 0)
+        errx(2, "error: invalid sort key: %s", optarg);
+      break;
+
+    case OPT_TOP:
+      show_top = 1;
+      break;
+
+    case OPT_STATE_SYNC:
+      rp->state_sync = exit_status_sync_mode(optarg);
+      if (rp->state_sync < 0)
+        errx(2, "error: invalid state sync mode: %s", optarg);
+      break;
+
     case OPT_LIMIT_CPU:
       errno = 0;
       rp->cpu = strtonum(optarg, -1, UINT32_MAX, &errstr);
@@ -229,7 +464,7 @@ int main(int argc, char *argv[]) {
       break;
 
     case OPT_DISABLE_SIGNAL_ON_EXIT:
-      signal_on_exit = 0;
+      rp->opt |= OPT_DISABLE_SIGNAL_ON_EXIT;
       break;
 
     case 'h':
@@ -242,15 +477,64 @@ int main(int argc, char *argv[]) {
   argc -= optind;
   argv += optind;
 
-  if (argc < 2) {
+  timeout = rp->timeout;
+
+  if (show_top) {
+    if (registry == NULL || argc != 0) {
+      usage();
+      exit(2);
+    }
+
+    if (top(registry, sort) < 0)
+      err(111, "top: %s", registry);
+
+    exit(0);
+  }
+
+  if (exit_record > -1) {
+    if (argc != 0) {
+      usage();
+      exit(2);
+    }
+
+    if (record_exit(rp, file, exit_record) < 0)
+      err(111, "record-exit: %s", file);
+
+    exit(0);
+  }
+
+  if (crontab == NULL
+          ? argc < 2
+          : (argc != 0 || control != NULL || registry != NULL ||
+                metrics != NULL || eventfd != -1 || cgroup != NULL ||
+                slots != NULL || pressure != NULL || heartbeat != 0 ||
+                factor != 0 || (rp->opt & OPT_SUBREAPER) || exec_task)) {
     usage();
     exit(2);
   }
 
-  cronentry = argv[0];
+  if (cgroup == NULL &&
+      (memory_max != NULL || cpu_max != NULL || io_max != NULL))
+    errx(2, "error: resource limits require --cgroup");
 
-  argc--;
-  argv++;
+  if (pressure == NULL && (rp->opt & OPT_PAUSE_ON_PRESSURE))
+    errx(2, "error: --pause-on-pressure requires --pressure");
+
+  if (exec_task &&
+      (heartbeat != 0 || rp->kill_after != 0 || control != NULL ||
+       (rp->opt & (OPT_PAUSE_ON_PRESSURE | OPT_SUBREAPER))))
+    errx(2, "error: --exec: the task is not supervised");
+
+  /* the timeout is enforced by alarm(2) */
+  if (exec_task && rp->signal != SIGTERM)
+    errx(2, "error: --exec: the task is terminated by SIGALRM");
+
+  if (heartbeat == 0 && heartbeat_mode != SUPERVISE_HEARTBEAT_FD)
+    errx(2, "error: --heartbeat-file and --heartbeat-output require "
+            "--heartbeat");
+
+  if (eventfd != -1 && events_open(eventfd) < 0)
+    err(111, "events-fd: %d", eventfd);
 
   procname = join(oargv, oargc);
   if (procname == NULL)
@@ -262,6 +546,34 @@ int main(int argc, char *argv[]) {
   if (!allow_setuid_subprocess && disable_setuid_subprocess() < 0)
     err(111, "disable_setuid_subprocess");
 
+  /* fail before sleeping if the task priority cannot be set */
+  if (priority_check() < 0)
+    err(111, "priority");
+
+  if (crontab != NULL) {
+    crontab_t *ct;
+
+    ct = crontab_open(rp, crontab, file, tag, now, wallclock);
+    if (ct == NULL)
+      exit(111);
+
+    if (rp->opt & OPT_DRYRUN)
+      exit(0);
+
+    if ((cwd != NULL) && (chdir(cwd) < 0))
+      err(111, "chdir: %s", cwd);
+
+    if (crontab_run(rp, ct, procname) < 0)
+      err(111, "crontab_run");
+
+    exit(111);
+  }
+
+  cronentry = argv[0];
+
+  argc--;
+  argv++;
+
   if (cronevent(rp, cronentry, &seconds, now) < 0)
     exit(111);
 
@@ -270,7 +582,7 @@ int main(int argc, char *argv[]) {
   if (seconds == UINT32_MAX)
     status = 255;
 
-  fd = open_exit_status(file, &status);
+  fd = open_exit_status(file, &es, rp->state_sync, &status);
   if (fd < 0)
     err(111, "open_exit_status: %s", file);
 
@@ -286,8 +598,8 @@ int main(int argc, char *argv[]) {
   }
 
   if (status != 0) {
-    if (seconds > retry_interval) {
-      seconds = retry_interval;
+    if (seconds > rp->retry_interval) {
+      seconds = rp->retry_interval;
     }
   }
 
@@ -299,8 +611,31 @@ int main(int argc, char *argv[]) {
       exit(111);
   }
 
+  /* --adaptive-timeout: a multiple of the 99th percentile of the run time
+   * of recent successful runs, limited by the timeout */
+  if (factor > 0) {
+    p99 = exit_status_percentile(&es, 99);
+    if (p99 >= 0) {
+      uint64_t ms = (uint64_t)(factor * (double)p99);
+
+      rp->adaptive_timeout =
+          (unsigned int)MIN((ms + 999) / 1000, UINT32_MAX - 1);
+      if (rp->adaptive_timeout == 0)
+        rp->adaptive_timeout = 1;
+    }
+  }
+
+  if (rp->adaptive_timeout > 0 && rp->adaptive_timeout < timeout)
+    timeout = rp->adaptive_timeout;
+
+  events_emit("parsed", ",\"seconds\":%u,\"timeout\":%u", seconds, timeout);
+
+  if (read_exit_status(&es, &last) < 0)
+    err(111, "read_exit_status: %s", file);
+
   if ((set_env("RUNCRON_TIMEOUT", timeout) < 0) ||
-      (set_env("RUNCRON_EXITSTATUS", status) < 0))
+      (set_env("RUNCRON_EXITSTATUS", status) < 0) ||
+      (exit_status_env(&last) < 0))
     err(111, "set_env");
 
   if (rp->verbose >= 1) {
@@ -312,22 +647,286 @@ int main(int argc, char *argv[]) {
         status, seconds, timeout);
   }
 
-  if (rp->opt & OPT_DRYRUN)
+  if (rp->verbose >= 2 && last.start > 0) {
+    print_argv(argc, argv);
+    (void)fprintf(stderr,
+                  ": last run: start=%lld end=%lld wall=%lldms signal=%d "
+                  "failures=%u lag=%lldus fork=%lldus exec=%lldus "
+                  "deferred=%us",
+                  (long long)last.start, (long long)last.end,
+                  (long long)last.wall, last.signal, last.failures,
+                  (long long)last.lag, (long long)last.fork,
+                  (long long)last.exec, last.deferred);
+    print_rusage(&last);
+  }
+
+  if (rp->opt & OPT_DRYRUN) {
+    events_flush();
     exit(0);
+  }
+
+  if (supervise_init(rp) < 0)
+    err(111, "supervise_init");
+
+  if (control != NULL) {
+    sockfd = supervise_control(control);
+    if (sockfd < 0)
+      err(111, "control: %s", control);
+  }
+
+  if (registry != NULL) {
+    /* the job is identified by the cron expression and the command */
+    char *name = join(argv - 1, argc + 1);
+
+    if (name == NULL)
+      err(111, "join");
+
+    if (registry_open(registry, name) < 0)
+      err(111, "registry: %s", registry);
+
+    free(name);
+  }
+
+  /* --heartbeat: the task is passed the write end of a pipe */
+  if (heartbeat > 0) {
+    hbfd = supervise_heartbeat(heartbeat, heartbeat_mode, heartbeat_file);
+    if (hbfd < 0)
+      err(111, "heartbeat");
+
+    if (heartbeat_mode == SUPERVISE_HEARTBEAT_FD &&
+        set_env("RUNCRON_HEARTBEAT_FD", hbfd) < 0)
+      err(111, "set_env");
+  }
+
+  if (metrics != NULL && metrics_open(metrics, tag) < 0)
+    err(111, "metrics: %s", metrics);
+
+  if (cgroup != NULL && cgroup_open(cgroup, memory_max, cpu_max, io_max) < 0) {
+    if (errno == EPERM)
+      errx(111, "cgroup: %s: runcron is not running in the delegated cgroup",
+           cgroup);
+    err(111, "cgroup: %s", cgroup);
+  }
+
+  if (slots != NULL && slots_open(slots) < 0)
+    err(111, "slots: %s", slots);
 
-  if (signal_init(sa_handler_sleep) < 0)
-    err(111, "signal_init");
+  if ((rp->opt & OPT_SUBREAPER) && subreaper_open() < 0)
+    err(111, "subreaper");
+
+  supervise_state(status, timeout);
 
   setproctitle(RUNCRON_TITLE, status == 0 ? "sleep" : "retry", seconds,
                procname);
 
-  sleepfor(seconds);
+  if (clock_gettime(RUNCRON_CLOCK_ELAPSED, &start) < 0)
+    err(111, "clock_gettime");
+
+  fire = wallclock + seconds;
+  deadline = fire;
+
+  for (;;) {
+    phase = deferring ? "defer" : status == 0 ? "sleep" : "retry";
+
+    registry_update(status == 0 ? REGISTRY_SLEEP : REGISTRY_RETRY, fire,
+                    timeout, status, 0);
+
+    if (metrics_update(status == 0 ? "sleep" : "retry", fire, status, &last) <
+        0)
+      warn("metrics: %s", metrics);
+
+    events_emit("sleeping", ",\"phase\":\"%s\",\"seconds\":%u,\"time\":%lld",
+                phase, seconds, (long long)fire);
+    events_flush();
+
+    PROBE2(sleep__start, seconds, fire);
+
+    rv = supervise_sleep(&deadline);
+    if (rv < 0)
+      err(111, "supervise_sleep");
+
+    PROBE2(sleep__done, rv, seconds);
+
+    events_emit("woke", ",\"reason\":\"%s\"", wake_reason[rv]);
+
+    if (rv == 0) {
+      /* --pressure: while the host is under pressure, defer the run in
+       * steps up to the maximum delay */
+      if (pressure == NULL || deferred >= pressure_max_delay)
+        break;
+
+      rv = pressure_exceeded();
+      if (rv < 0)
+        err(111, "pressure");
+
+      if (rv == 0)
+        break;
+
+      seconds = MIN(PRESSURE_INTERVAL, pressure_max_delay - deferred);
+      deferred += seconds;
+      deferring = 1;
+
+      now = time(NULL);
+      if (now == -1)
+        err(111, "time");
+
+      /* a deferred run keeps the scheduled time: the deferral is counted
+       * from the time the run was due or, if the run was started early,
+       * from the current time */
+      deadline = MAX(deadline, now) + seconds;
+
+      events_emit("deferred", ",\"seconds\":%u,\"deferred\":%u", seconds,
+                  deferred);
+
+      if (rp->verbose >= 1) {
+        print_argv(argc, argv);
+        (void)fprintf(stderr, ": host under pressure: deferring run by %us\n",
+                      seconds);
+      }
+
+      setproctitle(RUNCRON_TITLE, "defer", seconds, procname);
+      continue;
+    }
+
+    /* the clock was changed while the run was deferred: run now */
+    if (deferring && rv == SUPERVISE_CLOCK_CHANGED)
+      break;
+
+    if (rv == SUPERVISE_SKIP) {
+      deferring = 0;
+      deferred = 0;
+    }
+
+    now = time(NULL);
+    if (now == -1)
+      err(111, "time");
+
+    switch (rv) {
+    case SUPERVISE_CLOCK_CHANGED:
+      /* the system clock was changed: recalculate the time to the next run
+       * from the current time. The retry interval is not adjusted. */
+      if (reschedule(rp, cronentry, status, &start, now, &fire, &seconds,
+                     &timeout) < 0)
+        exit(111);
+      deadline = fire;
+      break;
+    case SUPERVISE_SKIP:
+      /* skip the next run: deadline is the time of the skipped run */
+      if (reschedule(rp, cronentry, status, NULL, deadline, &fire, &seconds,
+                     &timeout) < 0)
+        exit(111);
+      deadline = fire;
+      break;
+    default:
+      /* postpone: a deferred run keeps the scheduled time */
+      if (!deferring)
+        fire = deadline;
+      seconds = deadline > now ? (unsigned int)(deadline - now) : 0;
+      break;
+    }
+
+    supervise_state(status, timeout);
+
+    if (rp->verbose >= 1) {
+      print_argv(argc, argv);
+      (void)fprintf(stderr, ": sleep interval is %ds, command timeout is %us\n",
+                    seconds, timeout);
+    }
+
+    setproctitle(RUNCRON_TITLE,
+                 deferring ? "defer" : status == 0 ? "sleep" : "retry", seconds,
+                 procname);
+  }
+
+  /* --slots: the time waiting for a slot is included in the start
+   * latency. Signals are handled while waiting: a queued job exits
+   * without running the task. */
+  if (slots != NULL) {
+    setproctitle(RUNCRON_TITLE, "queued", 0, procname);
+
+    while ((slot = slots_acquire()) < 0) {
+      if (errno != EWOULDBLOCK)
+        err(111, "slots: %s", slots);
+
+      if (supervise_queue(SLOTS_POLL_INTERVAL) < 0)
+        err(111, "supervise_queue");
+    }
+
+    events_emit("slot", ",\"slot\":%d", slot);
+
+    if (rp->verbose >= 1) {
+      print_argv(argc, argv);
+      (void)fprintf(stderr, ": acquired slot %d\n", slot);
+    }
+  }
 
   if (status == 0) {
-    if (write_exit_status(fd, 128 + SIGKILL) < 0)
+    if (write_exit_status(&es, 128 + SIGKILL) < 0)
       err(111, "write_exit_status: %s", file);
   }
 
+  if (clock_gettime(CLOCK_REALTIME, &wake) < 0 ||
+      clock_gettime(RUNCRON_CLOCK_ELAPSED, &run) < 0)
+    err(111, "clock_gettime");
+
+  exit_status_start(&es, time(NULL));
+
+  if (sync_exit_status(&es, EXIT_STATUS_SYNC_FULL) < 0)
+    err(111, "sync_exit_status: %s", file);
+
+  /* --exec: the task replaces runcron. The lock is held by the task
+   * inheriting the state file descriptor. The exit status is recorded
+   * using --record-exit. */
+  if (exec_task) {
+    lag = (int64_t)(wake.tv_sec - fire) * 1000000 + wake.tv_nsec / 1000;
+
+    exit_status_latency(&es, lag, 0, 0);
+    exit_status_deferred(&es, deferred);
+
+    registry_update(REGISTRY_RUN, time(NULL), timeout, status, getpid());
+
+    if (metrics_update("run", fire, status, &last) < 0)
+      warn("metrics: %s", metrics);
+
+    PROBE3(task__exec, getpid(), 0, lag);
+    events_emit("exec", ",\"pid\":%d,\"error\":%d", (int)getpid(), 0);
+    events_flush();
+
+    if (rp->verbose >= 1) {
+      print_argv(argc, argv);
+      (void)fprintf(stderr, ": exec: lag=%lldus\n", (long long)lag);
+    }
+
+    if (supervise_child() < 0)
+      err(111, "supervise_child");
+
+    if (cgroup_join() < 0)
+      err(111, "cgroup: %s", cgroup);
+
+    if (priority_apply() < 0)
+      err(111, "priority");
+
+    if (fcntl(fd, F_SETFD, 0) < 0)
+      err(111, "fcntl");
+
+    if (slots_exec() < 0)
+      err(111, "slots: %s", slots);
+
+    if (registry_exec() < 0)
+      err(111, "registry: %s", registry);
+
+    /* the timer is preserved by exec(3): the task is terminated by
+     * SIGALRM */
+    if (timeout < UINT32_MAX)
+      (void)alarm(timeout);
+
+    (void)execvp(argv[0], argv);
+    err(errno == ENOENT ? 127 : 126, "%s", argv[0]);
+  }
+
+  if (execpipe(execfd) < 0)
+    err(111, "execpipe");
+
 #ifdef RESTRICT_PROCESS_capsicum
   pid = pdfork(&fdp, PD_CLOEXEC);
 #else
@@ -338,45 +937,91 @@ int main(int argc, char *argv[]) {
   case -1:
     err(111, "fork");
   case 0:
+    if (cgroup_join() < 0)
+      err(111, "cgroup: %s", cgroup);
+
     if (setsid() < 0)
       err(111, "setsid");
 
     if (restrict_process_signal_on_supervisor_exit() < 0)
       err(111, "restrict_process_signal_on_supervisor_exit");
 
+    if (priority_apply() < 0)
+      err(111, "priority");
+
+    /* --heartbeat: replaces descriptors of the supervisor: called after
+     * any descriptors are used by the child */
+    if (supervise_child() < 0)
+      err(111, "supervise_child");
+
     (void)execvp(argv[0], argv);
-    exit(errno == ENOENT ? 127 : 126);
+    error = errno;
+    while (write(execfd[1], &error, sizeof(error)) < 0 && errno == EINTR)
+      ;
+    exit(error == ENOENT ? 127 : 126);
   default:
-    if (restrict_process_wait(fdp) < 0) {
-      err(111, "restrict_process_wait");
+    if (clock_gettime(RUNCRON_CLOCK_ELAPSED, &forked) < 0)
+      err(111, "clock_gettime");
+
+    PROBE1(task__fork, pid);
+    events_emit("forked", ",\"pid\":%d", pid);
+
+    (void)close(execfd[1]);
+
+    if (supervise_task(pid, fdp) < 0) {
+      supervise_kill(rp->signal);
     }
 
-    if (signal_init(sa_handler_wait) < 0) {
-#ifdef RESTRICT_PROCESS_capsicum
-      (void)pdkill(fdp, default_signal);
-#else
-      (void)kill(-pid, default_signal);
-#endif
+    registry_update(REGISTRY_RUN, time(NULL), timeout, status, pid);
+
+    /* The supervisor cannot create files after restrict_process_wait():
+     * the result of the run is published by the next runcron process. */
+    if (metrics_update("run", fire, status, &last) < 0)
+      warn("metrics: %s", metrics);
+
+    /* start latency: the scheduled time of the run is a whole second */
+    error = waitexec(execfd[0]);
+    (void)close(execfd[0]);
+
+    if (clock_gettime(RUNCRON_CLOCK_ELAPSED, &exec) < 0)
+      err(111, "clock_gettime");
+
+    lag = (int64_t)(wake.tv_sec - fire) * 1000000 + wake.tv_nsec / 1000;
+
+    exit_status_latency(&es, lag, RUNCRON_USEC(run, forked),
+                        RUNCRON_USEC(forked, exec));
+    exit_status_deferred(&es, deferred);
+
+    PROBE3(task__exec, pid, error, lag);
+    events_emit("exec", ",\"pid\":%d,\"error\":%d", pid, error);
+    events_flush();
+
+    if (rp->verbose >= 1) {
+      print_argv(argc, argv);
+      (void)fprintf(stderr, ": started: lag=%lldus fork=%lldus exec=%lldus\n",
+                    (long long)lag, (long long)RUNCRON_USEC(run, forked),
+                    (long long)RUNCRON_USEC(forked, exec));
+      if (error > 0) {
+        print_argv(argc, argv);
+        (void)fprintf(stderr, ": exec: %s\n", strerror(error));
+      }
+    }
+
+    if (restrict_process_wait(fdp, sockfd) < 0) {
+      err(111, "restrict_process_wait");
     }
+
     if (rp->verbose >= 1) {
       print_argv(argc, argv);
       (void)fprintf(stderr, ": running command: timeout is set to %us\n",
                     timeout);
     }
-    if (timeout < UINT32_MAX) {
-      alarm(timeout);
-    }
     setproctitle(RUNCRON_TITLE, "running", timeout, procname);
-    if (waitfor(fdp, &status) < 0) {
-      warn("waitfor");
-#ifdef RESTRICT_PROCESS_capsicum
-      (void)pdkill(fdp, default_signal);
-#else
-      (void)kill(-pid, default_signal);
-#endif
+    if (supervise_wait(timeout, &status, &ru) < 0) {
+      warn("supervise_wait");
+      supervise_kill(rp->signal);
       exit(111);
     }
-    alarm(0);
   }
 
   if (WIFEXITED(status))
@@ -387,164 +1032,162 @@ int main(int argc, char *argv[]) {
   if (rp->verbose >= 3)
     (void)fprintf(stderr, "status=%d exit_value=%d\n", status, exit_value);
 
-  if (write_exit_status(fd, exit_value) < 0)
-    err(111, "write_exit_status: %s", file);
+  events_emit("exited", ",\"pid\":%d,\"status\":%d,\"signal\":%d", pid,
+              exit_value, WIFSIGNALED(status) ? WTERMSIG(status) : 0);
 
-  if (signal_on_exit) {
-#ifdef RESTRICT_PROCESS_capsicum
-    (void)pdkill(fdp, default_signal);
-#else
-    (void)kill(-pid, default_signal);
-#endif
-  }
+  if (clock_gettime(RUNCRON_CLOCK_ELAPSED, &ts) < 0)
+    err(111, "clock_gettime");
 
-  exit(exit_value);
-}
+  /* --subreaper: descendants orphaned by the task */
+  if (rp->opt & OPT_SUBREAPER) {
+    size_t i;
+
+    npids = sizeof(stragglers) / sizeof(stragglers[0]);
+    nstragglers = subreaper_stragglers(stragglers, &npids);
+    if (nstragglers < 0)
+      err(111, "subreaper");
+
+    nreaped = subreaper_rusage(&ru);
 
-void sleepfor(unsigned int seconds) {
-  while (seconds > 0 && !runnow) {
-    if (remaining) {
-      (void)fprintf(stderr, "%u\n", seconds);
-      remaining = 0;
+    events_emit("reaped", ",\"reaped\":%d,\"stragglers\":%d", nreaped,
+                nstragglers);
+
+    if (rp->verbose >= 1 && (nreaped > 0 || nstragglers > 0)) {
+      print_argv(argc, argv);
+      (void)fprintf(stderr, ": reaped %d descendants, %d still running",
+                    nreaped, nstragglers);
+      for (i = 0; i < npids; i++)
+        (void)fprintf(stderr, "%s%d", i == 0 ? ": " : " ", (int)stragglers[i]);
+      (void)fprintf(stderr, "\n");
     }
-    seconds = sleep(seconds);
   }
-}
 
-void sa_handler_sleep(int sig, siginfo_t *info, void *context) {
-  switch (sig) {
-  case SIGUSR1:
-  case SIGALRM:
-    runnow = 1;
-    break;
-  case SIGUSR2:
-    remaining = 1;
-    break;
-  case SIGINT:
-    _exit(111);
-  case SIGTERM:
-    _exit(111);
-  default:
-    break;
-  }
-}
+  if (cgroup_rusage(&ru) < 0)
+    warn("cgroup: %s", cgroup);
 
-void sa_handler_wait(int sig, siginfo_t *info, void *context) {
-  switch (sig) {
-  case SIGUSR1:
-  case SIGUSR2:
-    break;
-  case SIGALRM:
-    /* ignore SIGALRM generated by kill(2), sigqueue(3) */
-    if (info->si_pid != 0) {
-      return;
-    }
-    /* fallthrough */
-  default:
-    if (pid > 0)
-#ifdef RESTRICT_PROCESS_capsicum
-      (void)pdkill(fdp, sig == SIGALRM ? default_signal : sig);
-#else
-      (void)kill(-pid, sig == SIGALRM ? default_signal : sig);
-#endif
+  exit_status_end(&es, time(NULL),
+                  (int64_t)(ts.tv_sec - run.tv_sec) * 1000 +
+                      (ts.tv_nsec - run.tv_nsec) / 1000000,
+                  status, &ru);
+
+  if (rp->verbose >= 1 && read_exit_status(&es, &last) == 0) {
+    print_argv(argc, argv);
+    (void)fprintf(stderr, ": command exited: status=%d wall=%lldms",
+                  exit_value, (long long)last.wall);
+    print_rusage(&last);
   }
-}
 
-int signal_init(void (*handler)(int, siginfo_t *, void *)) {
-  struct sigaction act = {0};
-  int sig;
+  if (write_exit_status(&es, exit_value) < 0)
+    err(111, "write_exit_status: %s", file);
+
+  if (sync_exit_status(&es, EXIT_STATUS_SYNC_DATA) < 0)
+    err(111, "sync_exit_status: %s", file);
 
-  act.sa_flags |= SA_SIGINFO;
-  act.sa_sigaction = handler;
-  (void)sigfillset(&act.sa_mask);
+  events_emit("state", ",\"status\":%d", exit_value);
+  events_flush();
 
-  for (sig = 1; sig < NSIG; sig++) {
-    switch (sig) {
-    case SIGCHLD:
-      continue;
-    default:
-      break;
-    }
+  /* --cgroup: remove any processes remaining in the cgroup */
+  if (!(rp->opt & OPT_DISABLE_SIGNAL_ON_EXIT)) {
+    size_t i;
 
-    if (sigaction(sig, &act, NULL) < 0) {
-      if (errno == EINVAL)
-        continue;
+    supervise_kill(cgroup == NULL ? rp->signal : SIGKILL);
 
-      return -1;
-    }
+    /* --subreaper: stragglers may have left the process group */
+    for (i = 0; i < npids; i++)
+      (void)kill(stragglers[i], rp->signal);
   }
 
-  return 0;
+  exit(exit_value);
 }
 
-static int open_exit_status(char *file, int *status) {
+/* --record-exit: record the exit status of a task run using --exec. A
+ * status greater than 128 is recorded as termination by signal
+ * (status - 128). The resource usage of the task is not available. */
+static int record_exit(runcron_t *rp, char *file, int value) {
+  exit_status_t es;
+  exit_status_record_t rec;
+  struct rusage ru = {0};
+  int status = 0;
+  int64_t wall = 0;
+  time_t now;
   int fd;
 
-  fd = open(file, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
-
-  if (fd < 0) {
-    switch (errno) {
-    case EEXIST:
-      fd = open(file, O_RDWR | O_CLOEXEC, 0);
-      if (fd < 0)
-        return -1;
-      if (read_exit_status(fd, status) < 0) {
-        (void)close(fd);
-        return -1;
-      }
-      return fd;
-    default:
-      return -1;
-    }
-  }
+  fd = open_exit_status(file, &es, rp->state_sync, &status);
+  if (fd < 0)
+    return -1;
 
-  if (write_exit_status(fd, *status) < 0) {
-    (void)close(fd);
+  /* the lock is held while the task is running */
+  if (flock(fd, LOCK_EX | LOCK_NB) < 0)
     return -1;
-  }
 
-  return fd;
-}
+  if (read_exit_status(&es, &rec) < 0)
+    return -1;
 
-static int write_exit_status(int fd, int status) {
-  unsigned char buf;
+  now = time(NULL);
+  if (now == -1)
+    return -1;
 
-  buf = status > 255 ? 128 : (unsigned char)status;
+  if (rec.start > 0 && now >= rec.start)
+    wall = (int64_t)(now - rec.start) * 1000;
 
-  if (lseek(fd, 0, SEEK_SET) < 0)
-    return -1;
+  exit_status_end(&es, now, wall,
+                  value > 128 && value - 128 < NSIG ? W_EXITCODE(0, value - 128)
+                                                    : W_EXITCODE(value, 0),
+                  &ru);
 
-  if (write(fd, &buf, 1) != 1)
+  if (write_exit_status(&es, value) < 0)
     return -1;
 
-  return 0;
+  return sync_exit_status(&es, EXIT_STATUS_SYNC_DATA);
 }
 
-static int read_exit_status(int fd, int *status) {
-  unsigned char buf;
+/* Calculate the time of the next run after t (fire) and the time
+ * remaining until the run. If start is set, a retry interval is limited
+ * to the time remaining since start. */
+static int reschedule(runcron_t *rp, char *cronentry, int status,
+                      struct timespec *start, time_t t, time_t *fire,
+                      unsigned int *seconds, unsigned int *timeout) {
+  struct timespec ts;
+  time_t now;
+  time_t retry;
+  unsigned int next;
 
-  if (lseek(fd, 0, SEEK_SET) < 0)
+  now = time(NULL);
+  if (now == -1)
     return -1;
 
-  if (read(fd, &buf, 1) != 1)
+  if (cronevent(rp, cronentry, &next, t) < 0)
     return -1;
 
-  *status = buf;
-  return 0;
-}
+  /* the run is scheduled relative to the time used by cronevent() */
+  *fire = next == UINT32_MAX ? now + next : t + next;
 
-static int set_env(char *key, int val) {
-  char str[11];
-  int rv;
+  if (status != 0 && start != NULL) {
+    if (clock_gettime(RUNCRON_CLOCK_ELAPSED, &ts) < 0)
+      return -1;
 
-  rv = snprintf(str, sizeof(str), "%u", val);
-  if (rv < 0 || (unsigned)rv >= sizeof(str))
-    return -1;
+    retry = (time_t)rp->retry_interval - (ts.tv_sec - start->tv_sec);
+    if (retry < 0)
+      retry = 0;
 
-  if ((setenv(key, str, 1) < 0))
-    return -1;
+    if (*fire > now + retry)
+      *fire = now + retry;
+  }
+
+  *seconds = *fire > now ? (unsigned int)(*fire - now) : 0;
+
+  if (rp->timeout == 0) {
+    if (cronevent(rp, cronentry, timeout, *fire) < 0)
+      return -1;
+  }
+
+  if (rp->adaptive_timeout > 0 && rp->adaptive_timeout < *timeout)
+    *timeout = rp->adaptive_timeout;
 
-  return 0;
+  events_emit("parsed", ",\"seconds\":%u,\"timeout\":%u", *seconds,
+              *timeout);
+
+  return set_env("RUNCRON_TIMEOUT", *timeout);
 }
 
 static void print_argv(int argc, char *argv[]) {
@@ -556,34 +1199,14 @@ static void print_argv(int argc, char *argv[]) {
   }
 }
 
-static uint32_t seed_from_time(void) {
-  struct timeval tv = {0};
-
-  (void)gettimeofday(&tv, NULL);
-
-  return getpid() ^ tv.tv_sec ^ tv.tv_usec;
-}
-
-static int randinit(char *tag) {
-  uint32_t seed;
-  char name[MAXHOSTNAMELEN] = {0};
-  size_t len;
-
-  if (tag == NULL) {
-    if (gethostname(name, sizeof(name) - 1) < 0)
-      return -1;
-    tag = name;
-  }
-
-  len = strlen(tag);
-  seed = len == 0 ? seed_from_time() : fnv1a((uint8_t *)tag, len);
-
-#if defined(__OpenBSD__)
-  srandom_deterministic(seed);
-#else
-  srandom(seed);
-#endif
-  return 0;
+static void print_rusage(const exit_status_record_t *rec) {
+  (void)fprintf(stderr,
+                " utime=%lldms stime=%lldms maxrss=%lldkB inblock=%lld "
+                "oublock=%lld nvcsw=%lld nivcsw=%lld\n",
+                (long long)(rec->utime / 1000), (long long)(rec->stime / 1000),
+                (long long)rec->maxrss, (long long)rec->inblock,
+                (long long)rec->oublock, (long long)rec->nvcsw,
+                (long long)rec->nivcsw);
 }
 
 static char *join(char **arg, size_t n) {
@@ -637,11 +1260,13 @@ static void usage(void) {
   (void)fprintf(
       stderr,
       "[OPTION] <CRONTAB EXPRESSION> <command> <arg> <...>\n"
+      "[OPTION] --crontab <file>\n"
       "version: %s (using %s mode process restriction)\n\n"
       "-f, --file <file>              lock file path (default: .runcron.lock)\n"
       "-T, --timeout <seconds>        specify command timeout\n"
       "-R, --retry-interval <seconds> retry failed command (default: 3600)\n"
       "-C, --chdir <path>             change working directory\n"
+      "    --control <path>           listen for commands on a Unix socket\n"
       "-n, --dryrun                   do nothing\n"
       "-p, --print                    output seconds to next timespec\n"
       "-s, --signal <signum>          signal sent task on timeout (default: "
@@ -654,6 +1279,51 @@ static void usage(void) {
       "    --limit-as <uint32>        restrict memory (address space) of cron\n"
       "                                 expression parsing\n"
       "    --allow-setuid-subprocess  allow running unkillable tasks\n"
+      "    --crontab <file>           run the entries in a crontab file\n"
+      "    --registry <file>          publish job status to a shared file\n"
+      "    --metrics-file <file>      write Prometheus metrics to a file\n"
+      "    --events-fd <fd>           write JSON events to a file descriptor\n"
+      "    --cgroup <path>            run the task in a cgroup v2 leaf\n"
+      "    --memory-max <value>       --cgroup: set memory.max\n"
+      "    --cpu-max <value>          --cgroup: set cpu.max\n"
+      "    --io-max <value>           --cgroup: set io.max\n"
+      "    --nice <-20..19>           nice value of the task\n"
+      "    --sched <other|batch|idle> scheduling policy of the task\n"
+      "    --ioprio <class>[:<level>] I/O priority of the task: realtime,\n"
+      "                                 best-effort or idle, level 0-7\n"
+      "    --cpu-affinity <list>      CPUs the task may run on (0,2-3)\n"
+      "    --slots <name>:<n>         wait for one of n host-wide slots\n"
+      "    --subreaper                reap descendants orphaned by the task\n"
+      "    --init                     run as the init process of a container\n"
+      "    --exec                     replace runcron with the task\n"
+      "    --record-exit <status>     record the exit status of an --exec task\n"
+      "    --pressure <resource>:<percent>[,...]\n"
+      "                               defer the run while the host is under\n"
+      "                                 pressure (cpu, memory, io)\n"
+      "    --pressure-max-delay <seconds>\n"
+      "                               maximum time to defer a run (default: "
+      "300)\n"
+      "    --pause-on-pressure        stop the task while the host is under\n"
+      "                                 pressure\n"
+      "    --pause-extends-timeout    --pause-on-pressure: do not count the\n"
+      "                                 time stopped against the timeout\n"
+      "    --adaptive-timeout <factor>\n"
+      "                               limit the timeout to a multiple of the\n"
+      "                                 99th percentile of the run time\n"
+      "    --kill-after <seconds>     send SIGKILL if the task has not exited\n"
+      "                                 after the timeout signal\n"
+      "    --heartbeat <seconds>      terminate the task if no heartbeat is\n"
+      "                                 received within the interval\n"
+      "    --heartbeat-file <path>    --heartbeat: the task updates the\n"
+      "                                 modification time of the file\n"
+      "    --heartbeat-output         --heartbeat: the task writes to stdout\n"
+      "                                 or stderr\n"
+      "    --top                      display the jobs in the registry\n"
+      "    --sort <key>               --top: sort by time, pid, phase, status\n"
+      "                                 or name (default: time)\n"
+      "    --state-sync <none|data|full>\n"
+      "                               flush the state file to disk (default: "
+      "none)\n"
       "    --disable-process-restrictions\n"
       "                               do not fork cron expression processing\n"
       "    --disable-signal-on-exit   disable termination of subprocesses on "
@@ -12,23 +12,88 @@
  * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
+#include <stdint.h>
 #include <sys/resource.h>
 #include <sys/time.h>
+#include <time.h>
+
+#ifdef HAVE_SETPROCTITLE
+#define RUNCRON_TITLE "(%s %ds) %s"
+#else
+#define RUNCRON_TITLE "runcron: (%s %ds) %s"
+#endif
+
+/* elapsed time, including time the system was suspended */
+#ifdef CLOCK_BOOTTIME
+#define RUNCRON_CLOCK_ELAPSED CLOCK_BOOTTIME
+#else
+#define RUNCRON_CLOCK_ELAPSED CLOCK_MONOTONIC
+#endif
+
+/* microseconds from t0 to t1 */
+#define RUNCRON_USEC(t0, t1)                                                   \
+  ((int64_t)((t1).tv_sec - (t0).tv_sec) * 1000000 +                           \
+   ((t1).tv_nsec - (t0).tv_nsec) / 1000)
 
 typedef struct {
   int opt;
   int verbose;
   rlim_t cpu;
   rlim_t as;
+  unsigned int timeout;
+  unsigned int retry_interval;
+  int signal;
+  int state_sync;
+  /* --kill-after: seconds from the timeout signal to SIGKILL (0: disabled) */
+  unsigned int kill_after;
+  /* --adaptive-timeout: maximum timeout (0: disabled) */
+  unsigned int adaptive_timeout;
 } runcron_t;
 
+/* flags in runcron_t.opt: a long option setting a flag uses the flag as
+ * the getopt(3) code. Flags are less than the codes of other long
+ * options. */
 enum {
-  OPT_TIMESTAMP = 1 << 0,
+  OPT_PAUSE_ON_PRESSURE = 1 << 0,
   OPT_PRINT = 1 << 1,
   OPT_DRYRUN = 1 << 2,
   OPT_DISABLE_PROCESS_RESTRICTIONS = 1 << 3,
-  OPT_LIMIT_CPU = 1 << 4,
-  OPT_LIMIT_AS = 1 << 5,
+  OPT_PAUSE_EXTENDS_TIMEOUT = 1 << 4,
+  OPT_SUBREAPER = 1 << 5,
   OPT_DISABLE_SIGNAL_ON_EXIT = 1 << 6,
-  OPT_ALLOW_SETUID_SUBPROCESS = 1 << 7,
+  OPT_INIT = 1 << 7,
+};
+
+/* getopt(3) codes of long options without a flag in runcron_t.opt */
+enum {
+  OPT_TIMESTAMP = 256,
+  OPT_LIMIT_CPU,
+  OPT_LIMIT_AS,
+  OPT_ALLOW_SETUID_SUBPROCESS,
+  OPT_CRONTAB,
+  OPT_CONTROL,
+  OPT_REGISTRY,
+  OPT_TOP,
+  OPT_SORT,
+  OPT_STATE_SYNC,
+  OPT_METRICS_FILE,
+  OPT_EVENTS_FD,
+  OPT_CGROUP,
+  OPT_MEMORY_MAX,
+  OPT_CPU_MAX,
+  OPT_IO_MAX,
+  OPT_NICE,
+  OPT_SCHED,
+  OPT_IOPRIO,
+  OPT_CPU_AFFINITY,
+  OPT_SLOTS,
+  OPT_PRESSURE,
+  OPT_PRESSURE_MAX_DELAY,
+  OPT_HEARTBEAT,
+  OPT_HEARTBEAT_FILE,
+  OPT_HEARTBEAT_OUTPUT,
+  OPT_ADAPTIVE_TIMEOUT,
+  OPT_KILL_AFTER,
+  OPT_EXEC,
+  OPT_RECORD_EXIT,
 };
@@ -0,0 +1,46 @@
+/* Copyright (c) 2019-2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "set_env.h"
+
+int set_env(char *key, int val) {
+  char str[11];
+  int rv;
+
+  rv = snprintf(str, sizeof(str), "%u", val);
+  if (rv < 0 || (unsigned)rv >= sizeof(str))
+    return -1;
+
+  if ((setenv(key, str, 1) < 0))
+    return -1;
+
+  return 0;
+}
+
+int set_env_int64(char *key, int64_t val) {
+  char str[21];
+  int rv;
+
+  rv = snprintf(str, sizeof(str), "%lld", (long long)val);
+  if (rv < 0 || (unsigned)rv >= sizeof(str))
+    return -1;
+
+  if ((setenv(key, str, 1) < 0))
+    return -1;
+
+  return 0;
+}
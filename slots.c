@@ -0,0 +1,326 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "slots.h"
+
+#ifndef HAVE_STRTONUM
+#include "strtonum.h"
+#endif
+
+#define SLOTS_MAX 1024
+
+/* contents of the queue file */
+typedef struct {
+  /* ticket of the next process joining the queue */
+  uint64_t next;
+  /* lowest ticket of a process which may be waiting */
+  uint64_t head;
+} slots_queue_t;
+
+static int slots_ticket(void);
+static int slots_first(void);
+static void slots_dequeue(void);
+static int slots_lock(void);
+static int slots_read(slots_queue_t *q);
+static int slots_write(const slots_queue_t *q);
+static int slots_path(char *path, size_t size, const char *suffix,
+                      uint64_t t);
+static int slots_file(const char *suffix, int flags);
+
+static const char *slotname;
+static size_t slotlen;
+static int queuefd = -1;
+static int *slotfd;
+static int nslots;
+/* descriptor of the acquired slot */
+static int slotheld = -1;
+/* ticket file: locked while the process is waiting */
+static int ticketfd = -1;
+static uint64_t ticket;
+
+/* <name>:<n>: name is the path prefix of the slot files (<name>.0 to
+ * <name>.<n-1>), the queue file (<name>.queue) and the ticket files of
+ * waiting processes (<name>.queue.<ticket>). */
+int slots_open(const char *spec) {
+  const char *errstr = NULL;
+  const char *sep;
+  char suffix[16];
+  int i;
+
+  sep = strrchr(spec, ':');
+  if (sep == NULL || sep == spec) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  slotname = spec;
+  slotlen = (size_t)(sep - spec);
+
+  nslots = strtonum(sep + 1, 1, SLOTS_MAX, &errstr);
+  if (errstr != NULL)
+    return -1;
+
+  slotfd = calloc((size_t)nslots, sizeof(int));
+  if (slotfd == NULL)
+    return -1;
+
+  queuefd = slots_file("queue", O_RDWR);
+  if (queuefd < 0)
+    return -1;
+
+  for (i = 0; i < nslots; i++) {
+    (void)snprintf(suffix, sizeof(suffix), "%d", i);
+    slotfd[i] = slots_file(suffix, O_RDONLY);
+    if (slotfd[i] < 0)
+      return -1;
+  }
+
+  return 0;
+}
+
+/* Attempt to acquire a free slot without blocking. Processes acquire
+ * slots in the order of their tickets: the ticket is taken on the first
+ * attempt. The lock on the slot file is held until the process exits.
+ * Returns the slot number or -1 with errno set to EWOULDBLOCK if no slot
+ * is free or a process with an earlier ticket is waiting. */
+int slots_acquire(void) {
+  int slot = -1;
+  int rv;
+  int i;
+
+  if (ticketfd < 0 && slots_ticket() < 0)
+    return -1;
+
+  rv = slots_first();
+  if (rv <= 0) {
+    if (rv == 0)
+      errno = EWOULDBLOCK;
+    return -1;
+  }
+
+  for (i = 0; i < nslots; i++) {
+    if (flock(slotfd[i], LOCK_EX | LOCK_NB) == 0) {
+      slot = i;
+      break;
+    }
+
+    if (errno != EWOULDBLOCK)
+      return -1;
+  }
+
+  if (slot < 0)
+    return -1;
+
+  /* allow the next process in the queue to acquire a slot */
+  slots_dequeue();
+  (void)close(queuefd);
+  queuefd = -1;
+
+  for (i = 0; i < nslots; i++) {
+    if (i != slot)
+      (void)close(slotfd[i]);
+  }
+
+  slotheld = slotfd[slot];
+
+  return slot;
+}
+
+/* --exec: the acquired slot is held by the task: the slot descriptor is
+ * inherited across exec(3). */
+int slots_exec(void) {
+  if (slotheld < 0)
+    return 0;
+
+  return fcntl(slotheld, F_SETFD, 0);
+}
+
+/* Join the queue: the ticket file is created and locked while holding
+ * the queue lock. */
+static int slots_ticket(void) {
+  slots_queue_t q;
+  char path[PATH_MAX];
+  int rv = -1;
+
+  if (slots_lock() < 0)
+    return -1;
+
+  if (slots_read(&q) < 0)
+    goto UNLOCK;
+
+  if (slots_path(path, sizeof(path), "queue.", q.next) < 0)
+    goto UNLOCK;
+
+  ticketfd = open(path, O_RDONLY | O_CREAT | O_CLOEXEC, 0644);
+  if (ticketfd < 0)
+    goto UNLOCK;
+
+  if (flock(ticketfd, LOCK_EX | LOCK_NB) < 0) {
+    (void)close(ticketfd);
+    ticketfd = -1;
+    goto UNLOCK;
+  }
+
+  ticket = q.next++;
+
+  if (slots_write(&q) < 0)
+    goto UNLOCK;
+
+  rv = 0;
+
+UNLOCK:
+  (void)flock(queuefd, LOCK_UN);
+  return rv;
+}
+
+/* Returns 1 if no process with an earlier ticket is waiting. The ticket
+ * file of a process which exited while waiting is unlocked and removed. */
+static int slots_first(void) {
+  slots_queue_t q;
+  char path[PATH_MAX];
+  uint64_t t;
+  int rv = 1;
+  int fd;
+
+  if (slots_lock() < 0)
+    return -1;
+
+  if (slots_read(&q) < 0) {
+    rv = -1;
+    goto UNLOCK;
+  }
+
+  for (t = q.head; t < ticket; t++) {
+    if (slots_path(path, sizeof(path), "queue.", t) < 0) {
+      rv = -1;
+      break;
+    }
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      if (errno == ENOENT)
+        continue;
+      rv = -1;
+      break;
+    }
+
+    if (flock(fd, LOCK_SH | LOCK_NB) < 0) {
+      rv = errno == EWOULDBLOCK ? 0 : -1;
+      (void)close(fd);
+      break;
+    }
+
+    (void)unlink(path);
+    (void)close(fd);
+  }
+
+  if (rv >= 0 && t != q.head) {
+    q.head = t;
+    if (slots_write(&q) < 0)
+      rv = -1;
+  }
+
+UNLOCK:
+  (void)flock(queuefd, LOCK_UN);
+  return rv;
+}
+
+static void slots_dequeue(void) {
+  char path[PATH_MAX];
+
+  if (slots_path(path, sizeof(path), "queue.", ticket) == 0)
+    (void)unlink(path);
+
+  (void)close(ticketfd);
+  ticketfd = -1;
+}
+
+/* the queue lock is held while reading and updating the queue file */
+static int slots_lock(void) {
+  while (flock(queuefd, LOCK_EX) < 0) {
+    if (errno != EINTR)
+      return -1;
+  }
+
+  return 0;
+}
+
+static int slots_read(slots_queue_t *q) {
+  ssize_t n;
+
+  (void)memset(q, 0, sizeof(slots_queue_t));
+
+  n = pread(queuefd, q, sizeof(slots_queue_t), 0);
+  if (n < 0)
+    return -1;
+
+  /* new or truncated queue file */
+  if ((size_t)n != sizeof(slots_queue_t))
+    (void)memset(q, 0, sizeof(slots_queue_t));
+
+  return 0;
+}
+
+static int slots_write(const slots_queue_t *q) {
+  ssize_t n;
+
+  n = pwrite(queuefd, q, sizeof(slots_queue_t), 0);
+  if (n < 0)
+    return -1;
+
+  if ((size_t)n != sizeof(slots_queue_t)) {
+    errno = EIO;
+    return -1;
+  }
+
+  return 0;
+}
+
+static int slots_path(char *path, size_t size, const char *suffix,
+                      uint64_t t) {
+  int n;
+
+  n = snprintf(path, size, "%.*s.%s%llu", (int)slotlen, slotname, suffix,
+               (unsigned long long)t);
+  if (n < 0 || (size_t)n >= size) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  return 0;
+}
+
+static int slots_file(const char *suffix, int flags) {
+  char path[PATH_MAX];
+  int n;
+
+  n = snprintf(path, sizeof(path), "%.*s.%s", (int)slotlen, slotname,
+               suffix);
+  if (n < 0 || (size_t)n >= sizeof(path)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  return open(path, flags | O_CREAT | O_CLOEXEC, 0644);
+}
@@ -0,0 +1,27 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/* --slots: limit the number of tasks running concurrently on the host.
+ * A slot is an exclusive flock(2) on one of N slot files. Processes
+ * waiting for a slot take a ticket from a counter in the queue file and
+ * hold a lock on a ticket file: slots are acquired in ticket order (FIFO).
+ * Only the waiting process with the lowest ticket polls the slot files. */
+
+int slots_open(const char *spec);
+int slots_acquire(void);
+int slots_exec(void);
+
+/* interval between attempts to acquire a slot (milliseconds) */
+#define SLOTS_POLL_INTERVAL 100
@@ -0,0 +1,160 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include "subreaper.h"
+
+static void rusage_add(struct rusage *total, const struct rusage *ru);
+
+/* the children of runcron: requires CONFIG_PROC_CHILDREN (optional) */
+static int childfd = -1;
+/* resource usage of reaped descendants */
+static struct rusage reaped;
+static int nreaped;
+
+int subreaper_open(void) {
+#if defined(__linux__) && defined(PR_SET_CHILD_SUBREAPER)
+  char path[64];
+  int rv;
+
+  if (prctl(PR_SET_CHILD_SUBREAPER, 1, 0, 0, 0) < 0)
+    return -1;
+
+  rv = snprintf(path, sizeof(path), "/proc/self/task/%d/children",
+                (int)getpid());
+  if (rv < 0 || (size_t)rv >= sizeof(path))
+    return -1;
+
+  childfd = open(path, O_RDONLY | O_CLOEXEC);
+
+  return 0;
+#else
+  errno = ENOTSUP;
+  return -1;
+#endif
+}
+
+/* Reap any exited children: returns the pid of the task if the task was
+ * reaped, 0 if the task is running or -1 on error. The status and
+ * resource usage of the task are returned in status and ru. If task is
+ * 0, all exited children are reaped. */
+pid_t subreaper_reap(pid_t task, int *status, struct rusage *ru) {
+  struct rusage usage;
+  pid_t found = 0;
+  pid_t rv;
+  int st;
+
+  for (;;) {
+    rv = wait4(-1, &st, WNOHANG, &usage);
+    if (rv < 0)
+      return errno == ECHILD ? found : -1;
+
+    if (rv == 0)
+      return found;
+
+    if (rv == task) {
+      *status = st;
+      *ru = usage;
+      found = task;
+      continue;
+    }
+
+    rusage_add(&reaped, &usage);
+    nreaped++;
+  }
+}
+
+/* Add the resource usage of the reaped descendants: returns the number of
+ * descendants reaped. */
+int subreaper_rusage(struct rusage *ru) {
+  rusage_add(ru, &reaped);
+  return nreaped;
+}
+
+/* Returns the number of children still running after the task has exited.
+ * Up to n pids are written and n is set to the number of pids written. If
+ * the list of children is not available, the number is 1 if any children
+ * are running and no pids are written. */
+int subreaper_stragglers(pid_t *pids, size_t *n) {
+  size_t max = *n;
+  struct rusage usage;
+  char buf[4096];
+  char *p;
+  char *end;
+  ssize_t len;
+  long pid;
+  pid_t rv;
+  int count = 0;
+
+  *n = 0;
+
+  /* reap children exiting with the task: wait4(2) returns 0 if children
+   * are running */
+  while ((rv = wait4(-1, NULL, WNOHANG, &usage)) > 0) {
+    rusage_add(&reaped, &usage);
+    nreaped++;
+  }
+
+  if (rv < 0)
+    return errno == ECHILD ? 0 : -1;
+
+  if (childfd < 0)
+    return 1;
+
+  if (lseek(childfd, 0, SEEK_SET) < 0)
+    return -1;
+
+  len = read(childfd, buf, sizeof(buf) - 1);
+  if (len < 0)
+    return -1;
+
+  buf[len] = '\0';
+
+  /* space separated list of pids */
+  for (p = buf;; p = end) {
+    pid = strtol(p, &end, 10);
+    if (end == p)
+      break;
+
+    if (*n < max)
+      pids[(*n)++] = (pid_t)pid;
+    count++;
+  }
+
+  return count;
+}
+
+static void rusage_add(struct rusage *total, const struct rusage *ru) {
+  timeradd(&total->ru_utime, &ru->ru_utime, &total->ru_utime);
+  timeradd(&total->ru_stime, &ru->ru_stime, &total->ru_stime);
+  if (ru->ru_maxrss > total->ru_maxrss)
+    total->ru_maxrss = ru->ru_maxrss;
+  total->ru_inblock += ru->ru_inblock;
+  total->ru_oublock += ru->ru_oublock;
+  total->ru_nvcsw += ru->ru_nvcsw;
+  total->ru_nivcsw += ru->ru_nivcsw;
+}
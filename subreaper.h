@@ -0,0 +1,26 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <sys/resource.h>
+#include <sys/types.h>
+
+/* Subreaper: descendants orphaned by the task (for example, by creating a
+ * new session and exiting) are reparented to runcron instead of init.
+ * Exited descendants are reaped and their resource usage is added to the
+ * resource usage of the task. */
+
+int subreaper_open(void);
+pid_t subreaper_reap(pid_t task, int *status, struct rusage *ru);
+int subreaper_rusage(struct rusage *ru);
+int subreaper_stragglers(pid_t *pids, size_t *n);
@@ -0,0 +1,48 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include <sys/resource.h>
+#include <sys/types.h>
+
+/* supervise_sleep: the system clock was changed while sleeping */
+#define SUPERVISE_CLOCK_CHANGED 1
+/* supervise_sleep: skip the next run (control socket) */
+#define SUPERVISE_SKIP 2
+/* supervise_sleep: delay the next run (control socket) */
+#define SUPERVISE_POSTPONE 3
+
+/* supervise_heartbeat: the task writes to an inherited descriptor */
+#define SUPERVISE_HEARTBEAT_FD 0
+/* supervise_heartbeat: the task updates the modification time of a file */
+#define SUPERVISE_HEARTBEAT_FILE 1
+/* supervise_heartbeat: the task writes to stdout or stderr */
+#define SUPERVISE_HEARTBEAT_OUTPUT 2
+
+/* supervise_heartbeat: descriptor of the heartbeat pipe in the task: POSIX
+ * shells redirect descriptors 0 to 9 only */
+#define SUPERVISE_HEARTBEAT_FILENO 3
+
+/* seconds before a stalled task is sent SIGKILL */
+#define SUPERVISE_KILL_AFTER 10
+
+int supervise_init(runcron_t *rp);
+int supervise_control(const char *path);
+int supervise_heartbeat(unsigned int seconds, int mode, const char *path);
+void supervise_state(int status, unsigned int timeout);
+int supervise_sleep(time_t *next);
+int supervise_queue(unsigned int ms);
+int supervise_child(void);
+int supervise_task(pid_t pid, int fdp);
+int supervise_wait(unsigned int timeout, int *status, struct rusage *ru);
+void supervise_kill(int sig);
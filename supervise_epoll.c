@@ -0,0 +1,962 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "runcron.h"
+#include "supervise.h"
+#ifdef SUPERVISE_epoll
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cgroup.h"
+#include "control.h"
+#include "events.h"
+#include "pressure.h"
+#include "probe.h"
+#include "subreaper.h"
+
+/* supervise_request: no complete request is available */
+#define CONTROL_NONE -2
+
+/* All events are delivered through a single epoll instance:
+ *
+ * signalfd: signals are blocked and read from a file descriptor
+ * clockfd: the sleep deadline as an absolute wall clock time: the timer is
+ *          cancelled if the system clock is changed
+ * timerfd: the task timeout
+ * pidfd: task exit (falls back to SIGCHLD if pidfd_open(2) is unavailable).
+ *        With --subreaper, SIGCHLD is also used to reap descendants.
+ * ctlfd: control socket (optional): a single client connection is handled
+ *        at a time
+ * pressurefd: interval for checking host pressure while the task is
+ *             running (optional)
+ * stallfd: heartbeat timeout: reset by heartbeats from the task (optional)
+ * killfd: SIGKILL sent to a task that has not exited after the timeout
+ *         signal or a stall (optional)
+ * hbfd: heartbeat pipe or the task stdout and stderr (optional)
+ */
+
+static int supervise_idle(int sig);
+static int supervise_signal(struct signalfd_siginfo *si, int n);
+static int supervise_timer(int fd, unsigned int seconds);
+static pid_t supervise_reap(int *status, struct rusage *ru);
+static int supervise_killfd(void);
+static int supervise_exited(void);
+static int supervise_pressure(void);
+static ssize_t supervise_beat(int n);
+static int supervise_stalled(void);
+static void supervise_output(int fd, const char *buf, size_t len);
+static int supervise_freeze(int freeze);
+static int supervise_clock(time_t next);
+static long long elapsed(clockid_t clock, struct timespec *start);
+static unsigned int supervise_remaining(void);
+static void supervise_accept(void);
+static int supervise_request(unsigned int *arg);
+static void supervise_status(void);
+static void supervise_reply(const char *msg);
+static void supervise_close(void);
+static int supervise_add(int fd);
+static int supervise_read(int fd, void *buf, size_t len);
+
+static pid_t pid;
+static int default_signal = SIGTERM;
+static int verbose;
+static sigset_t oset;
+static int epfd = -1;
+static int sigfd = -1;
+static int timerfd = -1;
+static int clockfd = -1;
+static int pidfd = -1;
+static int ctlfd = -1;
+static int connfd = -1;
+static int pressurefd = -1;
+/* --pause-on-pressure: the task is stopped */
+static int frozen;
+static int pause_extends_timeout;
+/* remaining time of the task timeout when the task was stopped */
+static struct itimerspec paused;
+static int stallfd = -1;
+static int killfd = -1;
+static unsigned int kill_after;
+static int subreaper;
+/* --init: runcron is the init process of a pid namespace */
+static int init;
+/* --heartbeat: pipe read end or file (hbfd[0]), task stderr (hbfd[1]) */
+static int hbfd[2] = {-1, -1};
+/* --heartbeat: descriptors passed to the task */
+static int hbwfd[2] = {-1, -1};
+static int heartbeat_mode = SUPERVISE_HEARTBEAT_FD;
+static unsigned int heartbeat;
+static int stalled;
+static char req[128];
+static size_t reqlen;
+static const char *phase = "sleep";
+static int last_status;
+static unsigned int task_timeout;
+static time_t deadline;
+static struct timespec realtime;
+static struct timespec monotonic;
+static struct timespec boottime;
+
+int supervise_init(runcron_t *rp) {
+  sigset_t set;
+
+  default_signal = rp->signal;
+  verbose = rp->verbose;
+  kill_after = rp->kill_after;
+  subreaper = rp->opt & OPT_SUBREAPER;
+  init = rp->opt & OPT_INIT;
+
+  if (sigfillset(&set) < 0)
+    return -1;
+
+  if (sigprocmask(SIG_BLOCK, &set, &oset) < 0)
+    return -1;
+
+  sigfd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (sigfd < 0)
+    return -1;
+
+  timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timerfd < 0)
+    return -1;
+
+  clockfd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (clockfd < 0)
+    return -1;
+
+  epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (epfd < 0)
+    return -1;
+
+  if (supervise_add(sigfd) < 0 || supervise_add(timerfd) < 0 ||
+      supervise_add(clockfd) < 0)
+    return -1;
+
+  if (rp->opt & OPT_PAUSE_ON_PRESSURE) {
+    pause_extends_timeout = rp->opt & OPT_PAUSE_EXTENDS_TIMEOUT;
+
+    pressurefd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (pressurefd < 0 || supervise_add(pressurefd) < 0)
+      return -1;
+  }
+
+  if (kill_after > 0 && supervise_killfd() < 0)
+    return -1;
+
+  return 0;
+}
+
+int supervise_control(const char *path) {
+  ctlfd = control_listen(path);
+  if (ctlfd < 0)
+    return -1;
+
+  if (supervise_add(ctlfd) < 0)
+    return -1;
+
+  return ctlfd;
+}
+
+/* Create the heartbeat descriptors before the task is forked: returns the
+ * descriptor passed to the task in SUPERVISE_HEARTBEAT_FD mode, 0 in the
+ * other modes or -1 on error. */
+int supervise_heartbeat(unsigned int seconds, int mode, const char *path) {
+  int fds[2];
+  int i;
+
+  heartbeat = seconds;
+  heartbeat_mode = mode;
+
+  stallfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (stallfd < 0 || supervise_add(stallfd) < 0)
+    return -1;
+
+  if (supervise_killfd() < 0)
+    return -1;
+
+  if (mode == SUPERVISE_HEARTBEAT_FILE) {
+    hbfd[0] = open(path, O_RDONLY | O_CREAT | O_CLOEXEC, 0644);
+    return hbfd[0] < 0 ? -1 : 0;
+  }
+
+  for (i = 0; i < (mode == SUPERVISE_HEARTBEAT_OUTPUT ? 2 : 1); i++) {
+    if (pipe2(fds, O_CLOEXEC) < 0)
+      return -1;
+
+    /* the write end is blocking: the task may write to the pipe as stdout */
+    if (fcntl(fds[0], F_SETFL, O_NONBLOCK) < 0)
+      return -1;
+
+    hbfd[i] = fds[0];
+    hbwfd[i] = fds[1];
+  }
+
+  return mode == SUPERVISE_HEARTBEAT_FD ? SUPERVISE_HEARTBEAT_FILENO : 0;
+}
+
+void supervise_state(int status, unsigned int timeout) {
+  last_status = status;
+  task_timeout = timeout;
+}
+
+/* Sleep until the wall clock time of the next run. A skipped run returns
+ * the time of the skipped run and a postponed run the new time of the
+ * run. */
+int supervise_sleep(time_t *next) {
+  struct epoll_event ev[4];
+  struct signalfd_siginfo si[8];
+  uint64_t expired;
+  unsigned int arg = 0;
+  int n;
+  int i;
+
+  phase = last_status == 0 ? "sleep" : "retry";
+
+  if (supervise_clock(*next) < 0)
+    return -1;
+
+  for (;;) {
+    n = epoll_wait(epfd, ev, sizeof(ev) / sizeof(ev[0]), -1);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+
+    for (i = 0; i < n; i++) {
+      int j;
+      int len;
+
+      if (ev[i].data.fd == clockfd) {
+        long long jump;
+        long long suspend;
+
+        len = supervise_read(clockfd, &expired, sizeof(expired));
+        if (len == 0)
+          continue;
+
+        jump = (elapsed(CLOCK_REALTIME, &realtime) -
+                elapsed(CLOCK_MONOTONIC, &monotonic)) /
+               1000000000LL;
+
+        if (len < 0) {
+          if (errno != ECANCELED)
+            return -1;
+          if (verbose >= 1)
+            (void)fprintf(stderr, "clock changed by %+llds\n", jump);
+          return supervise_clock(0) < 0 ? -1 : SUPERVISE_CLOCK_CHANGED;
+        }
+
+        suspend = (elapsed(CLOCK_BOOTTIME, &boottime) -
+                   elapsed(CLOCK_MONOTONIC, &monotonic)) /
+                  1000000000LL;
+        if (verbose >= 1 && suspend > 0)
+          (void)fprintf(stderr, "system suspended for %llds\n", suspend);
+
+        return 0;
+      }
+
+      if (ev[i].data.fd == ctlfd) {
+        supervise_accept();
+        continue;
+      }
+
+      if (ev[i].data.fd == connfd) {
+        switch (supervise_request(&arg)) {
+        case CONTROL_NONE:
+          break;
+        case CONTROL_STATUS:
+          supervise_status();
+          break;
+        case CONTROL_RUN_NOW:
+          supervise_reply("ok");
+          return supervise_clock(0);
+        case CONTROL_SKIP_NEXT:
+          supervise_reply("ok");
+          return supervise_clock(0) < 0 ? -1 : SUPERVISE_SKIP;
+        case CONTROL_POSTPONE:
+          supervise_reply("ok");
+          *next += arg;
+          return supervise_clock(0) < 0 ? -1 : SUPERVISE_POSTPONE;
+        case CONTROL_CANCEL:
+          supervise_reply("ok");
+          exit(111);
+        default:
+          supervise_reply("error: invalid command");
+          break;
+        }
+        continue;
+      }
+
+      len = supervise_read(sigfd, si, sizeof(si));
+      if (len < 0)
+        return -1;
+
+      for (j = 0; j < len; j++) {
+        switch (si[j].ssi_signo) {
+        case SIGUSR1:
+        case SIGALRM:
+          return supervise_clock(0);
+        case SIGUSR2:
+          (void)fprintf(stderr, "%u\n", supervise_remaining());
+          break;
+        default:
+          if (supervise_idle(si[j].ssi_signo) < 0)
+            return -1;
+          break;
+        }
+      }
+    }
+  }
+}
+
+/* --slots: wait up to ms milliseconds before the next attempt to acquire
+ * a slot. Signals and control requests are handled: a queued job can be
+ * cancelled without starting the task. */
+int supervise_queue(unsigned int ms) {
+  struct epoll_event ev[4];
+  struct signalfd_siginfo si[8];
+  unsigned int arg = 0;
+  int n;
+  int i;
+
+  phase = "queued";
+  deadline = 0;
+
+  n = epoll_wait(epfd, ev, sizeof(ev) / sizeof(ev[0]), (int)ms);
+  if (n < 0)
+    return errno == EINTR ? 0 : -1;
+
+  for (i = 0; i < n; i++) {
+    int j;
+    int len;
+
+    if (ev[i].data.fd == ctlfd) {
+      supervise_accept();
+      continue;
+    }
+
+    if (ev[i].data.fd == connfd) {
+      switch (supervise_request(&arg)) {
+      case CONTROL_NONE:
+        break;
+      case CONTROL_STATUS:
+        supervise_status();
+        break;
+      case CONTROL_CANCEL:
+        supervise_reply("ok");
+        exit(111);
+      case -1:
+        supervise_reply("error: invalid command");
+        break;
+      default:
+        supervise_reply("error: job is queued");
+        break;
+      }
+      continue;
+    }
+
+    if (ev[i].data.fd != sigfd)
+      continue;
+
+    len = supervise_read(sigfd, si, sizeof(si));
+    if (len < 0)
+      return -1;
+
+    for (j = 0; j < len; j++) {
+      if (supervise_idle(si[j].ssi_signo) < 0)
+        return -1;
+    }
+  }
+
+  return 0;
+}
+
+int supervise_child(void) {
+  if (sigprocmask(SIG_SETMASK, &oset, NULL) < 0)
+    return -1;
+
+  if (hbwfd[0] < 0)
+    return 0;
+
+  /* --heartbeat-output: the task stdout and stderr are pipes */
+  if (heartbeat_mode == SUPERVISE_HEARTBEAT_OUTPUT) {
+    if (dup2(hbwfd[0], STDOUT_FILENO) < 0 || dup2(hbwfd[1], STDERR_FILENO) < 0)
+      return -1;
+    return 0;
+  }
+
+  /* the heartbeat descriptor is inherited by the task as a fixed, low
+   * numbered descriptor */
+  if (hbwfd[0] == SUPERVISE_HEARTBEAT_FILENO)
+    return fcntl(hbwfd[0], F_SETFD, 0);
+
+  return dup2(hbwfd[0], SUPERVISE_HEARTBEAT_FILENO) < 0 ? -1 : 0;
+}
+
+int supervise_task(pid_t task, int fdp) {
+  int i;
+
+  (void)fdp;
+
+  pid = task;
+  phase = "run";
+
+  for (i = 0; i < 2; i++) {
+    if (hbwfd[i] < 0)
+      continue;
+
+    (void)close(hbwfd[i]);
+    hbwfd[i] = -1;
+
+    if (supervise_add(hbfd[i]) < 0)
+      return -1;
+  }
+
+#ifdef SYS_pidfd_open
+  pidfd = syscall(SYS_pidfd_open, pid, 0);
+  if (pidfd < 0) {
+    if (errno == ENOSYS)
+      return 0;
+    return -1;
+  }
+
+  if (supervise_add(pidfd) < 0)
+    return -1;
+#endif
+
+  return 0;
+}
+
+int supervise_wait(unsigned int timeout, int *status, struct rusage *ru) {
+  struct epoll_event ev[4];
+  struct signalfd_siginfo si[8];
+  uint64_t expired;
+  unsigned int arg = 0;
+  pid_t rv;
+  int n;
+  int i;
+
+  if (timeout < UINT32_MAX && supervise_timer(timerfd, timeout) < 0)
+    return -1;
+
+  if (heartbeat > 0 && supervise_timer(stallfd, heartbeat) < 0)
+    return -1;
+
+  if (pressurefd > -1) {
+    struct itimerspec it = {{PRESSURE_INTERVAL, 0}, {PRESSURE_INTERVAL, 0}};
+
+    if (timerfd_settime(pressurefd, 0, &it, NULL) < 0)
+      return -1;
+  }
+
+  for (;;) {
+    n = epoll_wait(epfd, ev, sizeof(ev) / sizeof(ev[0]), -1);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+
+    for (i = 0; i < n; i++) {
+      int len;
+
+      if (ev[i].data.fd == pidfd) {
+        rv = supervise_reap(status, ru);
+        if (rv < 0)
+          return -1;
+        if (rv == pid)
+          return supervise_exited();
+        continue;
+      }
+
+      if (ev[i].data.fd == timerfd) {
+        if (supervise_read(timerfd, &expired, sizeof(expired)) > 0) {
+          PROBE2(timeout, pid, default_signal);
+          events_emit("timeout", ",\"signal\":%d", default_signal);
+          events_flush();
+          supervise_kill(default_signal);
+          if (kill_after > 0 && supervise_timer(killfd, kill_after) < 0)
+            return -1;
+        }
+        continue;
+      }
+
+      if (ev[i].data.fd == pressurefd) {
+        if (supervise_read(pressurefd, &expired, sizeof(expired)) > 0 &&
+            supervise_pressure() < 0)
+          return -1;
+        continue;
+      }
+
+      if (ev[i].data.fd == hbfd[0] || ev[i].data.fd == hbfd[1]) {
+        /* any data written by the task is a heartbeat */
+        len = (int)supervise_beat(ev[i].data.fd == hbfd[0] ? 0 : 1);
+        if (len < 0)
+          return -1;
+        if (len > 0 && !stalled && !frozen &&
+            supervise_timer(stallfd, heartbeat) < 0)
+          return -1;
+        continue;
+      }
+
+      if (ev[i].data.fd == stallfd) {
+        if (supervise_read(stallfd, &expired, sizeof(expired)) > 0 &&
+            supervise_stalled() < 0)
+          return -1;
+        continue;
+      }
+
+      if (ev[i].data.fd == killfd) {
+        if (supervise_read(killfd, &expired, sizeof(expired)) > 0) {
+          events_emit("kill", ",\"signal\":%d", SIGKILL);
+          events_flush();
+          supervise_kill(SIGKILL);
+        }
+        continue;
+      }
+
+      if (ev[i].data.fd == ctlfd) {
+        supervise_accept();
+        continue;
+      }
+
+      if (ev[i].data.fd == connfd) {
+        switch (supervise_request(&arg)) {
+        case CONTROL_NONE:
+          break;
+        case CONTROL_STATUS:
+          supervise_status();
+          break;
+        case CONTROL_CANCEL:
+          supervise_kill(default_signal);
+          supervise_reply("ok");
+          break;
+        case -1:
+          supervise_reply("error: invalid command");
+          break;
+        default:
+          supervise_reply("error: task is running");
+          break;
+        }
+        continue;
+      }
+
+      len = supervise_read(sigfd, si, sizeof(si));
+      if (len < 0)
+        return -1;
+
+      switch (supervise_signal(si, len)) {
+      case -1:
+        return -1;
+      case 0:
+        break;
+      default:
+        rv = supervise_reap(status, ru);
+        if (rv < 0)
+          return -1;
+        if (rv == pid)
+          return supervise_exited();
+        break;
+      }
+    }
+  }
+}
+
+void supervise_kill(int sig) {
+  /* a stopped task is resumed to handle the signal */
+  if (frozen)
+    (void)supervise_freeze(0);
+
+  if (cgroup_signal(sig) < 0)
+    (void)kill(-pid, sig);
+}
+
+/* Signals received while the task is not running. */
+static int supervise_idle(int sig) {
+  switch (sig) {
+  case SIGCHLD:
+    /* --init: reap processes reparented to runcron between runs */
+    if (init && subreaper_reap(0, NULL, NULL) < 0)
+      return -1;
+    break;
+  case SIGHUP:
+  case SIGQUIT:
+    /* --init: the default action of signals is not applied to the init
+     * process */
+    if (init)
+      exit(111);
+    break;
+  case SIGINT:
+  case SIGTERM:
+    exit(111);
+  default:
+    break;
+  }
+
+  return 0;
+}
+
+/* Forward signals to the task process group. Returns 1 if SIGCHLD was
+ * received and the task exit is not reported by a pidfd or descendants
+ * are reaped (--subreaper). */
+static int supervise_signal(struct signalfd_siginfo *si, int n) {
+  int sigchld = 0;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    switch (si[i].ssi_signo) {
+    case SIGCHLD:
+      sigchld = pidfd < 0 || subreaper;
+      break;
+    case SIGALRM:
+    case SIGUSR1:
+    case SIGUSR2:
+      break;
+    default:
+      PROBE2(signal__forward, pid, si[i].ssi_signo);
+      events_emit("signal", ",\"signal\":%d", si[i].ssi_signo);
+      events_flush();
+      supervise_kill(si[i].ssi_signo);
+      break;
+    }
+  }
+
+  return sigchld;
+}
+
+/* Reap the task: with --subreaper, any exited descendants are also
+ * reaped. */
+static pid_t supervise_reap(int *status, struct rusage *ru) {
+  if (subreaper)
+    return subreaper_reap(pid, status, ru);
+
+  return wait4(pid, status, WNOHANG, ru);
+}
+
+/* --pause-on-pressure: stop the task while the host is under pressure */
+static int supervise_pressure(void) {
+  int rv;
+
+  rv = pressure_exceeded();
+  if (rv < 0)
+    return -1;
+
+  return rv == frozen ? 0 : supervise_freeze(rv);
+}
+
+/* Stop or resume the task using cgroup.freeze or SIGSTOP/SIGCONT. With
+ * --pause-extends-timeout, the timeout is suspended while the task is
+ * stopped. */
+static int supervise_freeze(int freeze) {
+  struct itimerspec it = {0};
+
+  if (freeze && pause_extends_timeout &&
+      (timerfd_gettime(timerfd, &paused) < 0 ||
+       timerfd_settime(timerfd, 0, &it, NULL) < 0))
+    return -1;
+
+  /* --heartbeat: a stopped task cannot send heartbeats */
+  if (heartbeat > 0 && !stalled &&
+      supervise_timer(stallfd, freeze ? 0 : heartbeat) < 0)
+    return -1;
+
+  if (cgroup_freeze(freeze) < 0)
+    (void)kill(-pid, freeze ? SIGSTOP : SIGCONT);
+
+  frozen = freeze;
+
+  if (!freeze && pause_extends_timeout &&
+      timerfd_settime(timerfd, 0, &paused, NULL) < 0)
+    return -1;
+
+  events_emit(freeze ? "paused" : "resumed", ",\"pid\":%d", pid);
+  events_flush();
+
+  return 0;
+}
+
+/* --heartbeat: read from the heartbeat pipe or the task output. Output is
+ * copied to the supervisor stdout or stderr. Returns the number of bytes
+ * read (0 on end of file or if the read would block). */
+static ssize_t supervise_beat(int n) {
+  char buf[4096];
+  ssize_t len;
+
+  len = read(hbfd[n], buf, sizeof(buf));
+  if (len < 0)
+    return errno == EAGAIN ? 0 : -1;
+
+  if (len == 0) {
+    (void)close(hbfd[n]);
+    hbfd[n] = -1;
+    return 0;
+  }
+
+  if (heartbeat_mode == SUPERVISE_HEARTBEAT_OUTPUT)
+    supervise_output(n == 0 ? STDOUT_FILENO : STDERR_FILENO, buf,
+                     (size_t)len);
+
+  return len;
+}
+
+/* --heartbeat: no heartbeat was received within the interval. A heartbeat
+ * file is checked for modification when the timer expires. The stalled
+ * task is signalled and sent SIGKILL if it has not exited after
+ * --kill-after or SUPERVISE_KILL_AFTER seconds. */
+static int supervise_stalled(void) {
+  if (heartbeat_mode == SUPERVISE_HEARTBEAT_FILE) {
+    struct stat st;
+    struct timespec now;
+    time_t age;
+
+    if (fstat(hbfd[0], &st) < 0 || clock_gettime(CLOCK_REALTIME, &now) < 0)
+      return -1;
+
+    /* the modification time may be ahead if the clock was changed */
+    age = now.tv_sec - st.st_mtime;
+    if (age < 0)
+      age = 0;
+
+    if (age < (time_t)heartbeat)
+      return supervise_timer(stallfd, heartbeat - (unsigned int)age);
+  }
+
+  stalled = 1;
+
+  PROBE2(stall, pid, default_signal);
+  events_emit("stalled", ",\"signal\":%d,\"heartbeat\":%u", default_signal,
+              heartbeat);
+  events_flush();
+
+  supervise_kill(default_signal);
+
+  return supervise_timer(killfd,
+                         kill_after > 0 ? kill_after : SUPERVISE_KILL_AFTER);
+}
+
+static void supervise_output(int fd, const char *buf, size_t len) {
+  ssize_t n;
+
+  while (len > 0) {
+    n = write(fd, buf, len);
+    if (n < 0)
+      return;
+    buf += n;
+    len -= (size_t)n;
+  }
+}
+
+/* The task has exited: copy any output remaining in the pipes. */
+static int supervise_exited(void) {
+  int i;
+
+  for (i = 0; i < 2; i++)
+    while (hbfd[i] > -1 && heartbeat_mode == SUPERVISE_HEARTBEAT_OUTPUT &&
+           supervise_beat(i) > 0)
+      ;
+
+  return supervise_timer(timerfd, 0);
+}
+
+static int supervise_killfd(void) {
+  if (killfd > -1)
+    return 0;
+
+  killfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (killfd < 0)
+    return -1;
+
+  return supervise_add(killfd);
+}
+
+static int supervise_timer(int fd, unsigned int seconds) {
+  struct itimerspec it = {0};
+
+  it.it_value.tv_sec = seconds;
+
+  return timerfd_settime(fd, 0, &it, NULL);
+}
+
+/* Arm the sleep timer for the wall clock time of the next run (0:
+ * disarm). A time in the past expires immediately. */
+static int supervise_clock(time_t next) {
+  struct itimerspec it = {0};
+
+  if (next == 0) {
+    deadline = 0;
+    return timerfd_settime(clockfd, 0, &it, NULL);
+  }
+
+  if (clock_gettime(CLOCK_REALTIME, &realtime) < 0 ||
+      clock_gettime(CLOCK_MONOTONIC, &monotonic) < 0 ||
+      clock_gettime(CLOCK_BOOTTIME, &boottime) < 0)
+    return -1;
+
+  deadline = next;
+  it.it_value.tv_sec = deadline;
+
+  return timerfd_settime(clockfd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                         &it, NULL);
+}
+
+/* seconds until the sleep deadline */
+static unsigned int supervise_remaining(void) {
+  struct itimerspec it = {0};
+
+  if (timerfd_gettime(clockfd, &it) < 0)
+    return 0;
+
+  return (unsigned int)it.it_value.tv_sec +
+         (it.it_value.tv_nsec >= 500000000L);
+}
+
+/* Accept a control connection. A new connection replaces a pending
+ * connection. */
+static void supervise_accept(void) {
+  if (connfd > -1)
+    supervise_close();
+
+  connfd = accept4(ctlfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+  if (connfd < 0) {
+    switch (errno) {
+    case EAGAIN:
+    case EINTR:
+    case ECONNABORTED:
+      return;
+    default:
+      warn("control: disabled");
+      (void)close(ctlfd);
+      ctlfd = -1;
+      return;
+    }
+  }
+
+  if (supervise_add(connfd) < 0)
+    supervise_close();
+}
+
+/* Read a request from the control connection: returns the command,
+ * CONTROL_NONE if the request is incomplete or -1 if invalid. */
+static int supervise_request(unsigned int *arg) {
+  ssize_t n;
+
+  n = read(connfd, req + reqlen, sizeof(req) - 1 - reqlen);
+  if (n < 0) {
+    if (errno != EAGAIN)
+      supervise_close();
+    return CONTROL_NONE;
+  }
+
+  if (n == 0 && reqlen == 0) {
+    supervise_close();
+    return CONTROL_NONE;
+  }
+
+  reqlen += (size_t)n;
+  req[reqlen] = '\0';
+
+  /* the request is terminated by a newline or end of file */
+  if (n > 0 && strchr(req, '\n') == NULL) {
+    if (reqlen < sizeof(req) - 1)
+      return CONTROL_NONE;
+    return -1;
+  }
+
+  return control_command(req, arg);
+}
+
+static void supervise_status(void) {
+  char buf[128];
+  int sleeping = pid == 0 && deadline > 0;
+
+  (void)snprintf(buf, sizeof(buf),
+                 "phase=%s next=%lld remaining=%u timeout=%u status=%d pid=%d",
+                 phase, sleeping ? (long long)deadline : 0LL,
+                 sleeping ? supervise_remaining() : 0, task_timeout,
+                 last_status, (int)pid);
+
+  supervise_reply(buf);
+}
+
+/* Write the response and close the connection. */
+static void supervise_reply(const char *msg) {
+  char buf[256];
+  int n;
+
+  n = snprintf(buf, sizeof(buf), "%s\n", msg);
+  /* MSG_NOSIGNAL: the client may have disconnected */
+  if (n > 0 && (size_t)n < sizeof(buf))
+    (void)send(connfd, buf, (size_t)n, MSG_NOSIGNAL);
+
+  supervise_close();
+}
+
+static void supervise_close(void) {
+  (void)close(connfd);
+  connfd = -1;
+  reqlen = 0;
+}
+
+/* nanoseconds elapsed since start: the difference between clocks is
+ * converted to seconds after subtracting */
+static long long elapsed(clockid_t clock, struct timespec *start) {
+  struct timespec ts = {0};
+
+  if (clock_gettime(clock, &ts) < 0)
+    return 0;
+
+  return (long long)(ts.tv_sec - start->tv_sec) * 1000000000LL +
+         (ts.tv_nsec - start->tv_nsec);
+}
+
+static int supervise_add(int fd) {
+  struct epoll_event ev = {0};
+
+  ev.events = EPOLLIN;
+  ev.data.fd = fd;
+
+  return epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/* Read from a non-blocking descriptor: returns the number of records read
+ * (0 if the read would block). */
+static int supervise_read(int fd, void *buf, size_t len) {
+  ssize_t n;
+
+  n = read(fd, buf, len);
+  if (n < 0)
+    return errno == EAGAIN ? 0 : -1;
+
+  return fd == sigfd ? (int)(n / sizeof(struct signalfd_siginfo)) : 1;
+}
+#endif
@@ -0,0 +1,211 @@
+/* Copyright (c) 2019-2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "runcron.h"
+#include "supervise.h"
+#ifdef SUPERVISE_sigaction
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef RESTRICT_PROCESS_capsicum
+#include <sys/procdesc.h>
+#endif
+
+#include "cgroup.h"
+#include "probe.h"
+#include "waitfor.h"
+
+static void sleepuntil(time_t next);
+static int signal_init(void (*handler)(int, siginfo_t *, void *));
+static void sa_handler_sleep(int sig, siginfo_t *info, void *context);
+static void sa_handler_wait(int sig, siginfo_t *info, void *context);
+
+static pid_t pid;
+static int fdp = -1;
+static int default_signal = SIGTERM;
+static unsigned int kill_after;
+/* --kill-after: the timeout signal was sent */
+static volatile sig_atomic_t timedout = 0;
+static volatile sig_atomic_t runnow = 0;
+static volatile sig_atomic_t remaining = 0;
+
+int supervise_init(runcron_t *rp) {
+  /* pausing the task and reaping descendants require an event loop */
+  if (rp->opt & (OPT_PAUSE_ON_PRESSURE | OPT_SUBREAPER | OPT_INIT)) {
+    errno = ENOTSUP;
+    return -1;
+  }
+
+  default_signal = rp->signal;
+  kill_after = rp->kill_after;
+  return signal_init(sa_handler_sleep);
+}
+
+/* the control socket requires an event loop */
+int supervise_control(const char *path) {
+  (void)path;
+  errno = ENOTSUP;
+  return -1;
+}
+
+/* stall detection requires an event loop */
+int supervise_heartbeat(unsigned int seconds, int mode, const char *path) {
+  (void)seconds;
+  (void)mode;
+  (void)path;
+  errno = ENOTSUP;
+  return -1;
+}
+
+void supervise_state(int status, unsigned int timeout) {
+  (void)status;
+  (void)timeout;
+}
+
+int supervise_sleep(time_t *next) {
+  sleepuntil(*next);
+  return 0;
+}
+
+/* signals are handled by sa_handler_sleep() while waiting */
+int supervise_queue(unsigned int ms) {
+  struct timespec ts = {0};
+
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+
+  (void)nanosleep(&ts, NULL);
+  return 0;
+}
+
+int supervise_child(void) { return 0; }
+
+int supervise_task(pid_t task, int fd) {
+  pid = task;
+  fdp = fd;
+  return signal_init(sa_handler_wait);
+}
+
+int supervise_wait(unsigned int timeout, int *status, struct rusage *ru) {
+  if (timeout < UINT32_MAX) {
+    alarm(timeout);
+  }
+
+  if (waitfor(pid, fdp, status, ru) < 0)
+    return -1;
+
+  alarm(0);
+  return 0;
+}
+
+void supervise_kill(int sig) {
+#ifdef RESTRICT_PROCESS_capsicum
+  (void)pdkill(fdp, sig);
+#else
+  if (cgroup_signal(sig) < 0)
+    (void)kill(-pid, sig);
+#endif
+}
+
+static void sleepuntil(time_t next) {
+  time_t now;
+
+  while (!runnow && (now = time(NULL)) != -1 && now < next) {
+    if (remaining) {
+      (void)fprintf(stderr, "%u\n", (unsigned int)(next - now));
+      remaining = 0;
+    }
+    (void)sleep((unsigned int)(next - now));
+  }
+}
+
+static void sa_handler_sleep(int sig, siginfo_t *info, void *context) {
+  switch (sig) {
+  case SIGUSR1:
+  case SIGALRM:
+    runnow = 1;
+    break;
+  case SIGUSR2:
+    remaining = 1;
+    break;
+  case SIGINT:
+    _exit(111);
+  case SIGTERM:
+    _exit(111);
+  default:
+    break;
+  }
+}
+
+static void sa_handler_wait(int sig, siginfo_t *info, void *context) {
+  switch (sig) {
+  case SIGUSR1:
+  case SIGUSR2:
+    break;
+  case SIGALRM:
+    /* ignore SIGALRM generated by kill(2), sigqueue(3) */
+    if (info->si_pid != 0) {
+      return;
+    }
+    /* --kill-after: the task did not exit after the timeout signal */
+    if (timedout) {
+      supervise_kill(SIGKILL);
+      return;
+    }
+    PROBE2(timeout, pid, default_signal);
+    if (kill_after > 0) {
+      timedout = 1;
+      (void)alarm(kill_after);
+    }
+    /* fallthrough */
+  default:
+    if (pid > 0) {
+      if (sig != SIGALRM)
+        PROBE2(signal__forward, pid, sig);
+      supervise_kill(sig == SIGALRM ? default_signal : sig);
+    }
+  }
+}
+
+static int signal_init(void (*handler)(int, siginfo_t *, void *)) {
+  struct sigaction act = {0};
+  int sig;
+
+  act.sa_flags |= SA_SIGINFO;
+  act.sa_sigaction = handler;
+  (void)sigfillset(&act.sa_mask);
+
+  for (sig = 1; sig < NSIG; sig++) {
+    switch (sig) {
+    case SIGCHLD:
+      continue;
+    default:
+      break;
+    }
+
+    if (sigaction(sig, &act, NULL) < 0) {
+      if (errno == EINVAL)
+        continue;
+
+      return -1;
+    }
+  }
+
+  return 0;
+}
+#endif
@@ -251,3 +251,495 @@ EOF
   [ "$status" -eq 0 ]
   [ "$output" = "t3st" ]
 }
+
+@test "crontab file: schedule entries" {
+  rm -f .runcron.crontab .runcron.crontab.lock.*
+  printf '%s\n' \
+    '# comment' \
+    '' \
+    '*/5 * 26 * *      echo five' \
+    '0 */5 * 26 * * echo six' \
+    '=daily true' \
+    '0 0 * * mon-fri echo weekday' > .runcron.crontab
+  run runcron -np -f .runcron.crontab.lock --timestamp="2018-01-24 18:18:18" \
+        --crontab .runcron.crontab
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 0 ]
+  [ "${lines[0]}" -eq 106902 ]
+  [ "${lines[1]}" -eq 106902 ]
+  [ "${lines[2]}" -eq 20502 ]
+  [ "${lines[3]}" -eq 20502 ]
+}
+
+@test "crontab file: invalid entry" {
+  rm -f .runcron.crontab .runcron.crontab.lock.*
+  echo '* * * * *' > .runcron.crontab
+  run runcron -np -f .runcron.crontab.lock --crontab .runcron.crontab
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 111 ]
+  [ "$output" = "runcron: crontab: .runcron.crontab:1: invalid entry" ]
+}
+
+@test "crontab file: kill a task ignoring the timeout signal" {
+  rm -f .runcron.crontab .runcron.crontab.lock.*
+  echo '*/3 * * * * * trap "" TERM; sleep 30' > .runcron.crontab
+  run timeout 6 runcron -v -T 1 --kill-after 1 -f .runcron.crontab.lock \
+    --crontab .runcron.crontab
+cat << EOF
+$output
+EOF
+  [[ "$output" =~ "timeout: sending signal 15" ]]
+  [[ "$output" =~ "timeout: sending signal 9" ]]
+  [[ "$output" =~ "command exited: status=137" ]]
+}
+
+@test "crontab file: reject more entries than the open file limit" {
+  rm -f .runcron.crontab .runcron.crontab.lock.*
+  for i in $(seq 1 64); do
+    echo "@reboot true $i"
+  done > .runcron.crontab
+  run sh -c 'ulimit -n 64 && exec runcron -n -f .runcron.crontab.lock \
+    --crontab .runcron.crontab'
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 111 ]
+  [[ "$output" =~ "exceeds open file limit (64)" ]]
+}
+
+@test "control: drive the job using the control socket" {
+  if command -v socat >/dev/null; then
+    control() { echo "$1" | socat - UNIX-CONNECT:.runcron.control.sock; }
+  elif command -v nc >/dev/null; then
+    control() { echo "$1" | nc -U .runcron.control.sock; }
+  else
+    skip
+  fi
+  rm -f .runcron.control.sock .runcron.control.lock .runcron.control.err
+  printf '\000' > .runcron.control.lock
+  runcron -f .runcron.control.lock --control .runcron.control.sock \
+        "@daily" true 2> .runcron.control.err &
+  pid=$!
+  for i in 1 2 3 4 5 6 7 8 9 10; do
+    [ -S .runcron.control.sock ] && break
+    kill -0 $pid 2>/dev/null || break
+    sleep 0.1
+  done
+  grep -q "not supported" .runcron.control.err && skip
+
+  # a socket in use is not replaced
+  rm -f .runcron.state.lock
+  printf '\000' > .runcron.state.lock
+  run runcron -f .runcron.state.lock --control .runcron.control.sock \
+        "@daily" true
+  [ "$status" -eq 111 ]
+  [[ "$output" =~ "Address already in use" ]]
+
+  run control status
+cat << EOF
+$output
+EOF
+  [[ "$output" =~ ^phase=sleep\ next=([0-9]+)\ remaining=[0-9]+\ timeout=[0-9]+\ status=0\ pid=0$ ]]
+  next="${BASH_REMATCH[1]}"
+
+  run control "postpone 60"
+  [ "$output" = "ok" ]
+  run control status
+  [[ "$output" =~ next=$((next + 60))\  ]]
+
+  run control skip-next
+  [ "$output" = "ok" ]
+  run control status
+  [[ "$output" =~ next=([0-9]+)\  ]]
+  [ "${BASH_REMATCH[1]}" -gt $((next + 60)) ]
+
+  run control "postpone x"
+  [ "$output" = "error: invalid command" ]
+  run control restart
+  [ "$output" = "error: invalid command" ]
+
+  run control cancel
+  [ "$output" = "ok" ]
+  rc=0
+  wait $pid || rc=$?
+  [ "$rc" -eq 111 ]
+  rm -f .runcron.control.sock .runcron.control.lock .runcron.control.err
+}
+
+@test "registry: publish job status" {
+  rm -f .runcron.registry .runcron.registry.lock
+  runcron --registry .runcron.registry -f .runcron.registry.lock \
+    "@daily" true 3>&- &
+  pid=$!
+  sleep 1
+  run runcron --top --registry .runcron.registry
+  kill $pid
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 0 ]
+  [[ "$output" =~ $pid\ +sleep\ .*\ @daily\ true ]]
+}
+
+@test "state file: 1 byte format is readable" {
+  rm -f .runcron.state.lock
+  printf '\001' > .runcron.state.lock
+  run runcron -np -f .runcron.state.lock --timestamp="2018-01-24 18:18:18" \
+        "*/5 * 26 * *" true
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 0 ]
+  [ "$output" -eq 3600 ]
+  [ "$(wc -c < .runcron.state.lock)" -gt 1 ]
+
+  run runcron -R 0 -f .runcron.state.lock "*/5 * 26 * *" sh -c "exit 3"
+  [ "$status" -eq 3 ]
+  [ "$(od -An -tu1 -N1 .runcron.state.lock | tr -d ' ')" -eq 3 ]
+}
+
+@test "state file: export resource usage of last run" {
+  rm -f .runcron.state.lock
+  printf '\001' > .runcron.state.lock
+  run runcron -R 0 -f .runcron.state.lock "* * * * *" sh -c "exit 1"
+  [ "$status" -eq 1 ]
+
+  run runcron -R 0 -f .runcron.state.lock "* * * * *" \
+        sh -c 'echo "$RUNCRON_LAST_WALL $RUNCRON_LAST_MAXRSS"'
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 0 ]
+  [ "${output% *}" -ge 0 ]
+  [ "${output#* }" -gt 0 ]
+}
+
+@test "verbose: report start latency" {
+  rm -f .runcron.state.lock
+  printf '\001' > .runcron.state.lock
+  run runcron -v -R 0 -f .runcron.state.lock "* * * * *" true
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 0 ]
+  [[ "$output" =~ "true: started: lag="[0-9-]+"us fork="[0-9]+"us exec="[0-9]+"us" ]]
+}
+
+@test "metrics file: write job metrics" {
+  rm -f .runcron.state.lock .runcron.prom
+  printf '\001' > .runcron.state.lock
+  run runcron -R 0 -t test -f .runcron.state.lock \
+        --metrics-file .runcron.prom "* * * * *" true
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 0 ]
+  grep -q '^runcron_phase{tag="test",phase="run"} 1$' .runcron.prom
+  grep -q '^runcron_last_exit_status{tag="test"} 1$' .runcron.prom
+  [ ! -e .runcron.prom.tmp ]
+}
+
+@test "events: write lifecycle events" {
+  rm -f .runcron.state.lock
+  printf '\001' > .runcron.state.lock
+  run runcron -R 0 -f .runcron.state.lock --events-fd 3 "* * * * *" true \
+        3>.runcron.events
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 0 ]
+  run sed 's/^{"event":"\([a-z]*\)".*}$/\1/' .runcron.events
+cat << EOF
+$output
+EOF
+  [ "$(echo $output)" = "parsed sleeping woke forked exec exited state" ]
+  rm -f .runcron.events
+}
+
+@test "cgroup: kill processes escaping the process group" {
+  CGROUP="$(awk '$3 == "cgroup2" { print $2; exit }' /proc/mounts 2>/dev/null)"
+  [ -n "$CGROUP" ] && mkdir "$CGROUP/runcron-test.$$" 2>/dev/null || skip
+  rm -f .runcron.state.lock
+  printf '\001' > .runcron.state.lock
+  run runcron -R 0 -f .runcron.state.lock \
+        --cgroup "$CGROUP/runcron-test.$$/job" "* * * * *" \
+        sh -c 'setsid sleep 60 >/dev/null 2>&1 & echo $!'
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 0 ]
+  for i in 1 2 3 4 5 6 7 8 9 10; do
+    kill -0 "$output" 2>/dev/null || break
+    sleep 0.1
+  done
+  ! kill -0 "$output" 2>/dev/null
+  [ -z "$(cat "$CGROUP/runcron-test.$$/job/cgroup.procs")" ]
+  rmdir "$CGROUP/runcron-test.$$/job" "$CGROUP/runcron-test.$$"
+}
+
+@test "cgroup: reject running outside of the delegated subtree" {
+  CGROUP="$(awk '$3 == "cgroup2" { print $2; exit }' /proc/mounts 2>/dev/null)"
+  [ -n "$CGROUP" ] && command -v setpriv >/dev/null || skip
+  mkdir "$CGROUP/runcron-test.$$" 2>/dev/null || skip
+  chown -R nobody "$CGROUP/runcron-test.$$"
+  TMPDIR="$(mktemp -d)"
+  cp runcron "$TMPDIR"
+  printf '\001' > "$TMPDIR/state"
+  chmod 755 "$TMPDIR"
+  chmod 666 "$TMPDIR/state"
+  run setpriv --reuid=nobody --regid="$(id -g nobody)" --clear-groups \
+        "$TMPDIR/runcron" -R 0 -f "$TMPDIR/state" \
+        --cgroup "$CGROUP/runcron-test.$$/job" "* * * * *" true
+cat << EOF
+$output
+EOF
+  rm -rf "$TMPDIR"
+  rmdir "$CGROUP/runcron-test.$$"
+  [ "$status" -eq 111 ]
+  [[ "$output" =~ "not running in the delegated cgroup" ]]
+}
+
+@test "priority: set the nice value and scheduling policy of the task" {
+  case `uname -s` in
+    Linux) ;;
+    *) skip ;;
+  esac
+  rm -f .runcron.state.lock
+  printf '\001' > .runcron.state.lock
+  run runcron -R 0 -f .runcron.state.lock --nice 19 --sched batch \
+        "* * * * *" sh -c 'cut -d" " -f19,41 /proc/$$/stat'
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 0 ]
+  [ "$output" = "19 3" ]
+
+  run runcron -n --ioprio unknown "* * * * *" true
+  [ "$status" -eq 2 ]
+}
+
+@test "slots: wait for a free slot" {
+  rm -f .runcron.state.lock .runcron.slot.lock .runcron.slot.done \
+        .runcron.slot.0 .runcron.slot.queue*
+  printf '\001' > .runcron.state.lock
+  printf '\001' > .runcron.slot.lock
+  runcron -T 10 -R 0 -f .runcron.state.lock --slots .runcron.slot:1 \
+        "* * * * *" sh -c 'sleep 1; touch .runcron.slot.done' &
+  sleep 0.5
+  run runcron -v -R 0 -f .runcron.slot.lock --slots .runcron.slot:1 \
+        "* * * * *" test -e .runcron.slot.done
+cat << EOF
+$output
+EOF
+  wait
+  [ "$status" -eq 0 ]
+  [[ "$output" =~ "acquired slot 0" ]]
+  rm -f .runcron.slot.lock .runcron.slot.done .runcron.slot.0 \
+        .runcron.slot.queue*
+}
+
+@test "slots: a queued job exits on SIGTERM without running the task" {
+  rm -f .runcron.state.lock .runcron.slot.lock .runcron.slot.done \
+        .runcron.slot.0 .runcron.slot.queue*
+  printf '\001' > .runcron.state.lock
+  printf '\001' > .runcron.slot.lock
+  runcron -T 10 -R 0 -f .runcron.state.lock --slots .runcron.slot:1 \
+        "* * * * *" sleep 3 &
+  holder=$!
+  sleep 0.5
+  runcron -R 0 -f .runcron.slot.lock --slots .runcron.slot:1 \
+        "* * * * *" touch .runcron.slot.done &
+  queued=$!
+  sleep 1
+  kill -TERM $queued
+  rc=0
+  wait $queued || rc=$?
+  kill $holder
+  wait $holder || true
+  [ "$rc" -eq 111 ]
+  [ ! -e .runcron.slot.done ]
+  rm -f .runcron.slot.lock .runcron.slot.0 .runcron.slot.queue*
+}
+
+@test "slots: waiting jobs acquire a slot in order" {
+  rm -f .runcron.state.lock .runcron.slot.lock.* .runcron.slot.order \
+        .runcron.slot.0 .runcron.slot.queue*
+  printf '\001' > .runcron.state.lock
+  runcron -T 10 -R 0 -f .runcron.state.lock --slots .runcron.slot:1 \
+        "* * * * *" sleep 2 &
+  sleep 0.5
+  for i in 1 2 3; do
+    printf '\001' > .runcron.slot.lock.$i
+    runcron -R 0 -f .runcron.slot.lock.$i --slots .runcron.slot:1 \
+        "* * * * *" sh -c "echo $i >> .runcron.slot.order" &
+    sleep 0.3
+  done
+  wait
+  [ "$(echo $(cat .runcron.slot.order))" = "1 2 3" ]
+  [ -z "$(ls .runcron.slot.queue.* 2>/dev/null)" ]
+  rm -f .runcron.slot.lock.* .runcron.slot.order .runcron.slot.0 \
+        .runcron.slot.queue*
+}
+
+@test "pressure: defer the run while the host is under pressure" {
+  [ -r /proc/pressure/cpu ] || skip
+  run runcron -n --pressure cpu:101 "* * * * *" true
+  [ "$status" -eq 2 ]
+
+  run runcron -n --pause-on-pressure "* * * * *" true
+  [ "$status" -eq 2 ]
+
+  rm -f .runcron.state.lock
+  printf '\001' > .runcron.state.lock
+  run runcron -v -R 0 -f .runcron.state.lock --pressure cpu:100 \
+        "* * * * *" true
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 0 ]
+  [[ ! "$output" =~ "deferring run" ]]
+
+  grep -q "^some avg10=0.00 " /proc/pressure/cpu && skip
+  printf '\001' > .runcron.state.lock
+  run runcron -v -R 0 -f .runcron.state.lock --pressure cpu:0 \
+        --pressure-max-delay 1 "* * * * *" true
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 0 ]
+  [[ "$output" =~ "true: host under pressure: deferring run by 1s" ]]
+}
+
+@test "heartbeat: terminate a stalled task" {
+  run runcron -n --heartbeat-output "* * * * *" true
+  [ "$status" -eq 2 ]
+
+  rm -f .runcron.state.lock
+  printf '\001' > .runcron.state.lock
+  run runcron -R 0 -f .runcron.state.lock --heartbeat 1 \
+        "* * * * *" sh -c 'test -n "$RUNCRON_HEARTBEAT_FD" && sleep 5'
+cat << EOF
+$output
+EOF
+  [[ "$output" =~ "not supported" ]] && skip
+  [ "$status" -eq 143 ]
+
+  printf '\001' > .runcron.state.lock
+  run runcron -R 0 -f .runcron.state.lock --heartbeat 2 \
+        "* * * * *" sh -c 'for i in 1 2 3; do
+          echo >&$RUNCRON_HEARTBEAT_FD; sleep 0.5; done'
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 0 ]
+
+  printf '\001' > .runcron.state.lock
+  run runcron -R 0 -f .runcron.state.lock --heartbeat 2 --heartbeat-output \
+        "* * * * *" sh -c 'echo 1; sleep 0.5; echo 2 >&2; sleep 0.5; echo 3; sleep 5'
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 143 ]
+  [ "$output" = "$(printf '1\n2\n3')" ]
+}
+
+@test "timeout: adaptive timeout and kill escalation" {
+  rm -f .runcron.state.lock
+  printf '\001' > .runcron.state.lock
+  run runcron -R 0 -f .runcron.state.lock -T 1 --kill-after 1 \
+        "* * * * *" sh -c 'trap "" TERM; sleep 5'
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 137 ]
+
+  for i in 1 2 3 4 5 6 7 8 9 10; do
+    printf '\001' | dd of=.runcron.state.lock conv=notrunc 2>/dev/null
+    runcron -R 0 -f .runcron.state.lock "* * * * *" true
+  done
+  run runcron -n -v -R 0 -f .runcron.state.lock --adaptive-timeout 10 \
+        "* * * * *" true
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 0 ]
+  [[ "$output" =~ "command timeout is 1s" ]]
+}
+
+@test "subreaper: reap orphaned descendants" {
+  rm -f .runcron.state.lock
+  printf '\001' > .runcron.state.lock
+  run runcron -v -R 0 -f .runcron.state.lock --subreaper \
+        "* * * * *" sh -c '(setsid sleep 0.1 &); sleep 1'
+cat << EOF
+$output
+EOF
+  [[ "$output" =~ "not supported" ]] && skip
+  [ "$status" -eq 0 ]
+  [[ "$output" =~ "reaped 1 descendants, 0 still running" ]]
+}
+
+@test "init: run as the init process of a pid namespace" {
+  unshare -pf --mount-proc true 2>/dev/null || skip
+  rm -f .runcron.state.lock
+  printf '\001' > .runcron.state.lock
+  run unshare -pf --mount-proc runcron -v --init -R 0 \
+        -f .runcron.state.lock "* * * * *" \
+        sh -c 'test $PPID -eq 1 && (sleep 0.1 &) && sleep 1 && exit 3'
+cat << EOF
+$output
+EOF
+  [[ "$output" =~ "not supported" ]] && skip
+  [ "$status" -eq 3 ]
+  [[ "$output" =~ "reaped 1 descendants, 0 still running" ]]
+}
+
+@test "exec: replace runcron with the task" {
+  rm -f .runcron.state.lock
+  printf '\001' > .runcron.state.lock
+  run runcron -R 0 -f .runcron.state.lock --exec "* * * * *" \
+        sh -c 'exec 2>&1; runcron -f .runcron.state.lock --record-exit 0; exit 3'
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 3 ]
+  [[ "$output" =~ "Resource temporarily unavailable" ]]
+
+  run runcron -f .runcron.state.lock --record-exit 3
+  [ "$status" -eq 0 ]
+
+  run runcron -n -v -f .runcron.state.lock "* * * * *" true
+cat << EOF
+$output
+EOF
+  [[ "$output" =~ "last exit status was 3" ]]
+
+  run runcron -n --exec --subreaper "* * * * *" true
+  [ "$status" -eq 2 ]
+
+  run runcron -n --exec -s 9 "* * * * *" true
+  [ "$status" -eq 2 ]
+
+  # the slot is held by the task
+  rm -f .runcron.slot.0 .runcron.slot.queue
+  printf '\001' > .runcron.state.lock
+  run runcron -R 0 -f .runcron.state.lock --slots .runcron.slot:1 --exec \
+        "* * * * *" sh -c 'flock -n .runcron.slot.0 true'
+  [ "$status" -eq 1 ]
+  rm -f .runcron.slot.0 .runcron.slot.queue
+
+  # the registry record is held by the task
+  rm -f .runcron.registry
+  printf '\001' > .runcron.state.lock
+  run runcron -R 0 -f .runcron.state.lock --registry .runcron.registry \
+        --exec "* * * * *" sh -c 'runcron --top --registry .runcron.registry'
+cat << EOF
+$output
+EOF
+  [ "$status" -eq 0 ]
+  [[ "$output" =~ [0-9]+\ +run\ .*\ sh\ -c ]]
+}
@@ -0,0 +1,159 @@
+/* Copyright (c) 2025, Michael Santos <michael.santos@gmail.com>
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+#include "runcron.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "registry.h"
+#include "top.h"
+
+enum {
+  TOP_SORT_TIME,
+  TOP_SORT_PID,
+  TOP_SORT_PHASE,
+  TOP_SORT_STATUS,
+  TOP_SORT_NAME,
+};
+
+static const char *const sort_keys[] = {"time", "pid", "phase", "status",
+                                        "name", NULL};
+
+static const char *const phases[] = {"-", "sleep", "retry", "run"};
+
+static int compare(const void *a, const void *b);
+static long long elapsed(const registry_record_t *r, time_t now);
+
+static int sort_key = TOP_SORT_TIME;
+static time_t sort_now;
+
+int top_sort(const char *key) {
+  int i;
+
+  for (i = 0; sort_keys[i] != NULL; i++) {
+    if (strcmp(key, sort_keys[i]) == 0)
+      return i;
+  }
+
+  return -1;
+}
+
+/* Display the records in the registry. If stdout is a terminal, the
+ * display is refreshed every second. */
+int top(const char *path, int key) {
+  int live = isatty(STDOUT_FILENO);
+
+  sort_key = key;
+
+  for (;;) {
+    registry_record_t *rec = NULL;
+    ssize_t n;
+    ssize_t i;
+    size_t running = 0;
+    size_t retry = 0;
+
+    n = registry_read(path, &rec);
+    if (n < 0)
+      return -1;
+
+    sort_now = time(NULL);
+
+    qsort(rec, (size_t)n, sizeof(registry_record_t), compare);
+
+    for (i = 0; i < n; i++) {
+      if (rec[i].phase == REGISTRY_RUN)
+        running++;
+      else if (rec[i].phase == REGISTRY_RETRY)
+        retry++;
+    }
+
+    if (live)
+      (void)printf("\033[H\033[2J");
+
+    (void)printf("runcron: %zd jobs, %zu running, %zu retrying\n\n", n,
+                 running, retry);
+    (void)printf("%-8s %-6s %10s %10s %6s %-8s %s\n", "PID", "PHASE", "TIME",
+                 "TIMEOUT", "STATUS", "TASK", "NAME");
+
+    for (i = 0; i < n; i++) {
+      registry_record_t *r = &rec[i];
+      char task[16] = "-";
+      char timeout[16] = "-";
+
+      if (r->task > 0)
+        (void)snprintf(task, sizeof(task), "%d", r->task);
+
+      if (r->timeout != UINT32_MAX)
+        (void)snprintf(timeout, sizeof(timeout), "%u", r->timeout);
+
+      (void)printf("%-8d %-6s %10lld %10s %6d %-8s %s\n", r->pid,
+                   r->phase < sizeof(phases) / sizeof(phases[0])
+                       ? phases[r->phase]
+                       : "-",
+                   elapsed(r, sort_now), timeout, r->status, task, r->name);
+    }
+
+    free(rec);
+
+    if (!live)
+      return 0;
+
+    (void)fflush(stdout);
+    (void)sleep(1);
+  }
+}
+
+/* sleep/retry: seconds until the next run, run: seconds since the task
+ * started */
+static long long elapsed(const registry_record_t *r, time_t now) {
+  if (r->phase == REGISTRY_RUN)
+    return (long long)(now - r->time);
+
+  return r->time > now ? (long long)(r->time - now) : 0;
+}
+
+static int compare(const void *a, const void *b) {
+  const registry_record_t *x = a;
+  const registry_record_t *y = b;
+  long long d = 0;
+
+  switch (sort_key) {
+  case TOP_SORT_PID:
+    d = x->pid - y->pid;
+    break;
+  case TOP_SORT_PHASE:
+    d = (long long)y->phase - (long long)x->phase;
+    break;
+  case TOP_SORT_STATUS:
+    d = y->status - x->status;
+    break;
+  case TOP_SORT_NAME:
+    d = strcmp(x->name, y->name);
+    break;
+  default:
+    d = elapsed(x, sort_now) - elapsed(y, sort_now);
+    break;
+  }
+
+  if (d == 0)
+    d = x->pid - y->pid;
+
+  return d < 0 ? -1 : d > 0;
+}
@@ -13,21 +13,29 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 #include <errno.h>
+#include <fcntl.h>
 #include <signal.h>
+#include <unistd.h>
 
 #ifdef RESTRICT_PROCESS_capsicum
 #include <stdlib.h>
+#include <string.h>
 #include <sys/event.h>
 #endif
 
 #include "waitfor.h"
 
-int waitfor(int fdp, int *status) {
+/* Wait for the process to exit. If ru is not NULL, the resource usage of
+ * the process is returned: the resource usage is not available for process
+ * descriptors and is set to 0. */
+int waitfor(pid_t pid, int fdp, int *status, struct rusage *ru) {
 #ifdef RESTRICT_PROCESS_capsicum
   struct kevent event;
   int kq;
   int rv;
 
+  (void)pid;
+
   kq = kqueue();
   if (kq == -1)
     return -1;
@@ -46,12 +54,14 @@ int waitfor(int fdp, int *status) {
   }
 
   *status = (int)event.data;
+  if (ru != NULL)
+    (void)memset(ru, 0, sizeof(*ru));
   return 0;
 #else
   (void)fdp;
   for (;;) {
     errno = 0;
-    if (wait(status) < 0) {
+    if (wait4(pid, status, 0, ru) < 0) {
       if (errno == EINTR)
         continue;
       return -1;
@@ -60,3 +70,37 @@ int waitfor(int fdp, int *status) {
   }
 #endif
 }
+
+/* Create a close-on-exec pipe: the pipe is closed when the child calls
+ * exec(3). */
+int execpipe(int fd[2]) {
+  if (pipe(fd) < 0)
+    return -1;
+
+  if (fcntl(fd[0], F_SETFD, FD_CLOEXEC) < 0 ||
+      fcntl(fd[1], F_SETFD, FD_CLOEXEC) < 0) {
+    (void)close(fd[0]);
+    (void)close(fd[1]);
+    return -1;
+  }
+
+  return 0;
+}
+
+/* Wait for a child to exec(3): fd is the read end of a close-on-exec pipe.
+ * If exec(3) fails, the child writes errno to the pipe before exiting.
+ * Returns 0 if the child exec'ed, the errno of the failed exec(3) or -1. */
+int waitexec(int fd) {
+  int error = 0;
+  ssize_t n;
+
+  for (;;) {
+    n = read(fd, &error, sizeof(error));
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    return n == sizeof(error) ? error : 0;
+  }
+}
@@ -13,6 +13,9 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 #include <sys/types.h>
+#include <sys/resource.h>
 #include <sys/wait.h>
 
-int waitfor(int fdp, int *status);
+int waitfor(pid_t pid, int fdp, int *status, struct rusage *ru);
+int execpipe(int fd[2]);
+int waitexec(int fd);